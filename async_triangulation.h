@@ -0,0 +1,81 @@
+#pragma once
+
+#include "triangulator.h"
+
+// STL
+#include <future>
+#include <memory>
+#include <vector>
+
+// A triangulation running in the background, on a thread of its own and the workers
+// of its triangulator, see basic_triangulator. Other threads follow it with
+// num_processed() and stop it with cancel(): a request that timed out cancels its
+// triangulation, whose tasks not started yet are then dropped, and the partial
+// triangulation is freed with the last of this object and the background thread.
+// Not thread safe itself, only progress(), cancel() and cancelled() may be called
+// while another thread waits for result().
+template <int D, typename T>
+class basic_async_triangulation {
+public:
+	typedef basic_triangulator<D, T> triangulator_type;
+	typedef typename triangulator_type::point_type point_type;
+	typedef std::vector<simplex<D> > result_type;
+
+	// Start triangulating the points, which must outlive the triangulation.
+	basic_async_triangulation(span<point_type const> xyzs, int num_thread,
+		typename triangulator_type::location_mode mode = triangulator_type::AUTOMATIC_LOCATION,
+		typename triangulator_type::insertion_mode insertion = triangulator_type::LOCKING_TASKS) :
+		tri_(new triangulator_type(num_thread, xyzs.size(), mode, insertion)), num_points_(xyzs.size())
+	{
+		std::shared_ptr<triangulator_type> tri = tri_;
+		result_ = std::async(std::launch::async, [tri, xyzs] {
+			tri->points_.assign(xyzs);
+			tri->insert_pending();
+			return tri->cancelled() ? result_type() : tri->triangulate();
+		});
+	}
+	basic_async_triangulation(std::vector<point_type> const& xyzs, int num_thread,
+		typename triangulator_type::location_mode mode = triangulator_type::AUTOMATIC_LOCATION,
+		typename triangulator_type::insertion_mode insertion = triangulator_type::LOCKING_TASKS) :
+		basic_async_triangulation(span<point_type const>(xyzs.data(), xyzs.size()), num_thread, mode, insertion)
+	{
+	}
+	// Cancel the triangulation if it runs, and wait for its tasks running.
+	~basic_async_triangulation() {
+		if (!tri_) return;
+		tri_->cancel();
+		if (result_.valid()) result_.wait();
+	}
+
+	basic_async_triangulation(basic_async_triangulation&&) = default;
+
+	// The tetras of the triangulation once it is done, as triangulate() returns them,
+	// none if it was cancelled.
+	std::future<result_type>& result() {
+		return result_;
+	}
+
+	// Points inserted or dropped so far, of num_points(), see num_processed().
+	size_t progress() const {
+		return tri_->num_processed();
+	}
+	size_t num_points() const {
+		return num_points_;
+	}
+
+	void cancel() {
+		tri_->cancel();
+	}
+	bool cancelled() const {
+		return tri_->cancelled();
+	}
+
+private:
+	// shared with the background thread, whichever is done last frees it
+	std::shared_ptr<triangulator_type> tri_;
+	size_t num_points_;
+	std::future<result_type> result_;
+};
+
+typedef basic_async_triangulation<3> async_triangulation;
+typedef basic_async_triangulation<2> async_triangulation_2d;
@@ -0,0 +1,46 @@
+#include <memory>
+#include <thread>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include "batch.h"
+#include "triangulator.h"
+using namespace std;
+
+
+void triangulate_batch(vector<span<xyz const> > const& sets, vector<vector<tetra> >& tetras, batch_options const& options)
+{
+    int num_threads = options.num_threads > 0 ? options.num_threads : max(1, int(thread::hardware_concurrency()));
+    tetras.assign(sets.size(), vector<tetra>());
+    vector<size_t> small, large;
+    for (size_t i = 0; i < sets.size(); ++i)
+        (sets[i].size() <= options.small_points ? small : large).push_back(i);
+
+    // a triangulator per worker, made on its first set; sized for the largest small
+    // set, and without a hierarchy, which only pays off for millions of points
+    size_t max_points = 0;
+    for (size_t i : small)
+        max_points = max(max_points, sets[i].size());
+    tbb::enumerable_thread_specific<unique_ptr<triangulator> > workers;
+    tbb::task_arena arena(num_threads);
+    arena.execute([&] {
+        // a set per task, the workers take the next one as they finish
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, small.size(), 1), [&](tbb::blocked_range<size_t> const& r) {
+            auto&& tri = workers.local();
+            if (!tri)
+                tri.reset(new triangulator(1, max_points, triangulator::CONFLICT_LISTS));
+            for (size_t j = r.begin(); j < r.end(); ++j)
+            {
+                tri->reset(sets[small[j]]);
+                tetras[small[j]] = tri->triangulate();
+            }
+        }, tbb::simple_partitioner());
+    });
+
+    for (size_t i : large)
+    {
+        triangulator tri(sets[i], num_threads);
+        tetras[i] = tri.triangulate();
+    }
+}
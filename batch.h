@@ -0,0 +1,29 @@
+#ifndef BATCH_H
+
+#define BATCH_H
+
+#include <cstddef>
+#include <vector>
+#include "types.h"
+
+// Delaunay triangulation of many independent point sets. Small sets go to a shared
+// pool of workers, one set per worker at a time, each triangulated on its worker
+// alone by a triangulator the worker keeps from set to set (triangulator::reset()),
+// so a set costs no thread start and almost no allocation. Large sets are then
+// triangulated one after the other on all workers.
+
+struct batch_options {
+	// sets of at most small_points points are small
+	size_t small_points;
+	// number of workers, 0 for all cores
+	int num_threads;
+	batch_options() : small_points(10000), num_threads(0) {}
+};
+
+// Triangulate every set, tetras[i] getting the finite tetras of sets[i] as
+// triangulator::triangulate() returns them, in the keys of the points of the set.
+// The points are not copied; spatially sorted sets (spatial_sort) insert fastest.
+void triangulate_batch(std::vector<span<xyz const> > const& sets, std::vector<std::vector<tetra> >& tetras,
+		batch_options const& options = batch_options());
+
+#endif /* end of include guard: BATCH_H */
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "types.h"
+#include "batch.h"
+#include "spatialsort.h"
+#include "triangulator.h"
+using namespace std;
+
+
+// Benchmark of the triangulator on synthetic point sets, sweeping the number of
+// threads. Every run of a distribution triangulates the same seeded points, so
+// results of different builds can be compared. Writes <out>.csv and <out>.json.
+// --dim 2 triangulates the x and y of the points instead, tetras are then triangles.
+// --precision float rounds the points to floats and triangulates them as such.
+// --insertion rounds inserts in lock free rounds instead of locking tasks.
+// --batch M splits the points into independent sets of M points, each drawn from the
+// distribution, and triangulates them all with triangulate_batch(); sets/s is then
+// the figure to watch.
+//
+//   ./benchmark [--points N] [--repeats R] [--warmup W] [--threads T] [--seed S]
+//               [--dist cube,ball,sphere,clusters,lattice,degenerate,terrain] [--dim 3|2]
+//               [--precision double|float] [--insertion tasks|rounds] [--batch M] [--out PREFIX]
+
+// Points uniform in the unit cube.
+static vector<xyz> generate_cube(size_t num, mt19937_64& rng)
+{
+    uniform_real_distribution<REAL> u(0, 1);
+    vector<xyz> ret(num);
+    for (auto&& p : ret)
+        p = {u(rng), u(rng), u(rng)};
+    return ret;
+}
+
+// Points uniform in the ball inscribed in the unit cube.
+static vector<xyz> generate_ball(size_t num, mt19937_64& rng)
+{
+    uniform_real_distribution<REAL> u(-1, 1);
+    vector<xyz> ret;
+    ret.reserve(num);
+    while (ret.size() < num)
+    {
+        xyz p = {u(rng), u(rng), u(rng)};
+        if (p[0] * p[0] + p[1] * p[1] + p[2] * p[2] > 1)
+            continue;
+        ret.push_back({0.5 + 0.5 * p[0], 0.5 + 0.5 * p[1], 0.5 + 0.5 * p[2]});
+    }
+    return ret;
+}
+
+// Points uniform on the sphere inscribed in the unit cube, all on the hull.
+static vector<xyz> generate_sphere(size_t num, mt19937_64& rng)
+{
+    normal_distribution<REAL> g(0, 1);
+    vector<xyz> ret;
+    ret.reserve(num);
+    while (ret.size() < num)
+    {
+        xyz p = {g(rng), g(rng), g(rng)};
+        REAL len = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (len == 0)
+            continue;
+        ret.push_back({0.5 + 0.5 * p[0] / len, 0.5 + 0.5 * p[1] / len, 0.5 + 0.5 * p[2] / len});
+    }
+    return ret;
+}
+
+// Points in 16 Gaussian clusters around uniform centers, very uneven density.
+static vector<xyz> generate_clusters(size_t num, mt19937_64& rng)
+{
+    size_t const num_clusters = 16;
+    uniform_real_distribution<REAL> u(0.1, 0.9);
+    normal_distribution<REAL> g(0, 0.02);
+    vector<xyz> centers(num_clusters);
+    for (auto&& c : centers)
+        c = {u(rng), u(rng), u(rng)};
+    vector<xyz> ret(num);
+    for (size_t i = 0; i < num; ++i)
+    {
+        xyz const& c = centers[i % num_clusters];
+        ret[i] = {c[0] + g(rng), c[1] + g(rng), c[2] + g(rng)};
+    }
+    return ret;
+}
+
+// Points of a regular grid, shuffled: many coplanar and cospherical points.
+static vector<xyz> generate_lattice(size_t num, mt19937_64& rng)
+{
+    size_t side = max<size_t>(2, size_t(ceil(cbrt(REAL(num)))));
+    vector<xyz> ret;
+    ret.reserve(side * side * side);
+    for (size_t i = 0; i < side && ret.size() < num; ++i)
+        for (size_t j = 0; j < side && ret.size() < num; ++j)
+            for (size_t k = 0; k < side && ret.size() < num; ++k)
+                ret.push_back({REAL(i) / side, REAL(j) / side, REAL(k) / side});
+    shuffle(ret.begin(), ret.end(), rng);
+    return ret;
+}
+
+// Lattice points moved by a tiny relative amount: almost degenerate, so the
+// exact predicates take their slow paths.
+static vector<xyz> generate_degenerate(size_t num, mt19937_64& rng)
+{
+    vector<xyz> ret = generate_lattice(num, rng);
+    uniform_real_distribution<REAL> u(-1e-12, 1e-12);
+    for (auto&& p : ret)
+        p = {p[0] + u(rng), p[1] + u(rng), p[2] + u(rng)};
+    return ret;
+}
+
+// Points uniform in the unit square, at the height of a smooth terrain over it.
+static vector<xyz> generate_terrain(size_t num, mt19937_64& rng)
+{
+    uniform_real_distribution<REAL> u(0, 1);
+    vector<xyz> ret(num);
+    for (auto&& p : ret)
+    {
+        REAL x = u(rng);
+        REAL y = u(rng);
+        p = {x, y, 0.1 * sin(7 * x) * cos(5 * y)};
+    }
+    return ret;
+}
+
+struct distribution {
+    char const* name;
+    vector<xyz> (*generate)(size_t, mt19937_64&);
+};
+
+static distribution const distributions[] = {
+    {"cube", generate_cube},
+    {"ball", generate_ball},
+    {"sphere", generate_sphere},
+    {"clusters", generate_clusters},
+    {"lattice", generate_lattice},
+    {"degenerate", generate_degenerate},
+    {"terrain", generate_terrain},
+};
+
+struct result {
+    string distribution;
+    size_t num_points;
+    // triangulated one after the other, 1 but with --batch
+    size_t num_sets;
+    int num_threads;
+    int repeats;
+    double median;
+    double p95;
+    double min;
+    double speedup;
+    size_t num_tetras;
+    int num_jobs;
+    // of the last repeat, with make STATS=1
+    triangulation_stats stats;
+};
+
+// Nearest rank percentile of sorted times.
+static double percentile(vector<double> const& sorted, double p)
+{
+    size_t rank = size_t(ceil(p * sorted.size()));
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+static void write_csv(string const& path, vector<result> const& results)
+{
+    ofstream os(path.c_str());
+    os << "distribution,num_points,threads,repeats,median_s,p95_s,min_s,points_per_s,speedup,tetras,jobs,sets,sets_per_s\n";
+    for (auto&& r : results)
+    {
+        os << r.distribution << ',' << r.num_points << ',' << r.num_threads << ',' << r.repeats << ','
+           << r.median << ',' << r.p95 << ',' << r.min << ',' << r.num_points / r.median << ','
+           << r.speedup << ',' << r.num_tetras << ',' << r.num_jobs << ',' << r.num_sets << ',' << r.num_sets / r.median << '\n';
+    }
+}
+
+static void write_json(string const& path, vector<result> const& results, unsigned long long seed, int warmup, int dim,
+                       bool single_precision, bool rounds)
+{
+    ofstream os(path.c_str());
+    os << "{\n  \"seed\": " << seed << ",\n  \"warmup\": " << warmup << ",\n  \"dim\": " << dim
+       << ",\n  \"precision\": \"" << (single_precision ? "float" : "double") << "\",\n  \"insertion\": \""
+       << (rounds ? "rounds" : "tasks") << "\",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        auto&& r = results[i];
+        os << (i ? "," : "") << "\n    {\"distribution\": \"" << r.distribution << "\", \"num_points\": " << r.num_points
+           << ", \"threads\": " << r.num_threads << ", \"repeats\": " << r.repeats
+           << ", \"median_s\": " << r.median << ", \"p95_s\": " << r.p95 << ", \"min_s\": " << r.min
+           << ", \"points_per_s\": " << r.num_points / r.median << ", \"speedup\": " << r.speedup
+           << ", \"tetras\": " << r.num_tetras << ", \"jobs\": " << r.num_jobs
+           << ", \"sets\": " << r.num_sets << ", \"sets_per_s\": " << r.num_sets / r.median;
+        STATS(os << ", \"stats\": "; r.stats.write_json(os));
+        os << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: ./benchmark [--points N] [--repeats R] [--warmup W] [--threads T] [--seed S]\n"
+                    "                   [--dist cube,ball,sphere,clusters,lattice,degenerate,terrain] [--dim 3|2]\n"
+                    "                   [--precision double|float] [--insertion tasks|rounds] [--batch M] [--out PREFIX]\n");
+    exit(1);
+}
+
+// Triangulate in D dimensions with coordinates of type T and return the time it took.
+// The counts of the run go to r.
+template <int D, typename T>
+static double run(vector<array<T, 3> > const& points, int num_threads, bool rounds, result& r)
+{
+    typedef basic_triangulator<D, T> triangulator_type;
+    auto start_time = chrono::steady_clock::now();
+    triangulator_type tri(points, num_threads, triangulator_type::AUTOMATIC_LOCATION,
+                          rounds ? triangulator_type::ROUNDS : triangulator_type::LOCKING_TASKS);
+    vector<simplex<D> > tetras = tri.triangulate();
+    auto end_time = chrono::steady_clock::now();
+    r.num_tetras = tetras.size();
+    r.num_jobs = tri.get_num_jobs();
+    r.stats = tri.stats();
+    return chrono::duration<double>(end_time - start_time).count();
+}
+
+// Triangulate the sets with triangulate_batch() and return the time it took.
+static double run_batch(vector<span<xyz const> > const& sets, size_t set_points, int num_threads, result& r)
+{
+    batch_options options;
+    options.small_points = set_points;
+    options.num_threads = num_threads;
+    vector<vector<tetra> > tetras;
+    auto start_time = chrono::steady_clock::now();
+    triangulate_batch(sets, tetras, options);
+    auto end_time = chrono::steady_clock::now();
+    r.num_tetras = 0;
+    for (auto&& t : tetras)
+        r.num_tetras += t.size();
+    r.num_jobs = 0;
+    return chrono::duration<double>(end_time - start_time).count();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t num_points = 100000;
+    int repeats = 5;
+    int warmup = 1;
+    int max_threads = max(1, int(thread::hardware_concurrency()));
+    unsigned long long seed = 1;
+    string dists = "cube,ball,sphere,clusters,lattice,degenerate";
+    string out = "benchmark";
+    int dim = 3;
+    bool single_precision = false;
+    bool rounds = false;
+    size_t set_points = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 == argc)
+            usage();
+        char const* value = argv[++i];
+        if (strcmp(argv[i - 1], "--points") == 0)
+            num_points = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i - 1], "--repeats") == 0)
+            repeats = max(1, atoi(value));
+        else if (strcmp(argv[i - 1], "--warmup") == 0)
+            warmup = max(0, atoi(value));
+        else if (strcmp(argv[i - 1], "--threads") == 0)
+            max_threads = max(1, atoi(value));
+        else if (strcmp(argv[i - 1], "--seed") == 0)
+            seed = strtoull(value, nullptr, 10);
+        else if (strcmp(argv[i - 1], "--dist") == 0)
+            dists = value;
+        else if (strcmp(argv[i - 1], "--out") == 0)
+            out = value;
+        else if (strcmp(argv[i - 1], "--dim") == 0 && (atoi(value) == 2 || atoi(value) == 3))
+            dim = atoi(value);
+        else if (strcmp(argv[i - 1], "--precision") == 0 && (strcmp(value, "double") == 0 || strcmp(value, "float") == 0))
+            single_precision = strcmp(value, "float") == 0;
+        else if (strcmp(argv[i - 1], "--insertion") == 0 && (strcmp(value, "tasks") == 0 || strcmp(value, "rounds") == 0))
+            rounds = strcmp(value, "rounds") == 0;
+        else if (strcmp(argv[i - 1], "--batch") == 0 && atoi(value) > 0)
+            set_points = strtoul(value, nullptr, 10);
+        else
+            usage();
+    }
+    // batches are 3D and double
+    if (set_points && (dim != 3 || single_precision))
+        usage();
+
+    // 1, 2, 4, ... and max_threads itself
+    vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    vector<result> results;
+    for (auto&& d : distributions)
+    {
+        if (("," + dists + ",").find(string(",") + d.name + ",") == string::npos)
+            continue;
+        mt19937_64 rng(seed);
+        vector<xyz> xyzs;
+        vector<span<xyz const> > sets;
+        if (set_points)
+        {
+            // the sets one after the other in xyzs, each sorted on its own
+            size_t num_sets = max<size_t>(1, num_points / set_points);
+            for (size_t s = 0; s < num_sets; ++s)
+            {
+                vector<xyz> set = d.generate(set_points, rng);
+                spatial_sort(set);
+                xyzs.insert(xyzs.end(), set.begin(), set.end());
+            }
+            for (size_t s = 0; s < num_sets; ++s)
+                sets.push_back(span<xyz const>(xyzs.data() + s * set_points, set_points));
+        }
+        else
+        {
+            xyzs = d.generate(num_points, rng);
+            spatial_sort(xyzs);
+        }
+        vector<xyzf> xyzfs;
+        if (single_precision)
+        {
+            for (auto&& p : xyzs)
+                xyzfs.push_back({float(p[0]), float(p[1]), float(p[2])});
+        }
+        double base = 0;
+        for (int num_threads : thread_counts)
+        {
+            result r;
+            r.distribution = d.name;
+            r.num_points = xyzs.size();
+            r.num_sets = set_points ? sets.size() : 1;
+            r.num_threads = num_threads;
+            r.repeats = repeats;
+            vector<double> times;
+            for (int j = 0; j < warmup + repeats; ++j)
+            {
+                double time;
+                if (set_points)
+                    time = run_batch(sets, set_points, num_threads, r);
+                else if (single_precision)
+                    time = dim == 2 ? run<2>(xyzfs, num_threads, rounds, r) : run<3>(xyzfs, num_threads, rounds, r);
+                else
+                    time = dim == 2 ? run<2>(xyzs, num_threads, rounds, r) : run<3>(xyzs, num_threads, rounds, r);
+                if (j >= warmup)
+                    times.push_back(time);
+            }
+            sort(times.begin(), times.end());
+            r.median = times.size() % 2 ? times[times.size() / 2] : 0.5 * (times[times.size() / 2 - 1] + times[times.size() / 2]);
+            r.p95 = percentile(times, 0.95);
+            r.min = times.front();
+            if (num_threads == 1)
+                base = r.median;
+            r.speedup = base / r.median;
+            results.push_back(r);
+            printf("%-10s %9zu points %3d threads: median %.4f s, p95 %.4f s, %.0f points/s, speedup %.2f",
+                   d.name, r.num_points, num_threads, r.median, r.p95, r.num_points / r.median, r.speedup);
+            if (set_points)
+                printf(", %zu sets, %.0f sets/s", r.num_sets, r.num_sets / r.median);
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    write_csv(out + ".csv", results);
+    write_json(out + ".json", results, seed, warmup, dim, single_precision, rounds);
+}
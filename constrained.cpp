@@ -0,0 +1,460 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include "constrained.h"
+#include "triangulator.h"
+using namespace std;
+
+
+// Points reserved per input point and constraint face for the Steiner points.
+static size_t const STEINER_POINTS_PER_INPUT = 3;
+
+// A constraint edge or a piece of one, between its points a < b.
+struct segment
+{
+    point_k a;
+    point_k b;
+    // the facets it bounds
+    vector<int> facets;
+};
+
+typedef unordered_map<pair<point_k, point_k>, size_t, boost::hash<pair<point_k, point_k> > > segment_map;
+
+// A constraint face cut into pieces, triangles of its points oriented like it and
+// Delaunay in its plane. The points added in the current round have keys -1, -2, ...
+// and their positions in added.
+struct facet
+{
+    // a point off the plane, on the positive side of every piece
+    xyz apex;
+    vector<triangle> pieces;
+    vector<xyz> added;
+    // the segments to split before the pieces can be refined further
+    vector<size_t> requests;
+};
+
+// A point of a facet, the position of an added point for a negative key.
+static REAL* pos(vector<xyz> const& points, facet const& f, point_k k)
+{
+    return const_cast<REAL*>(k >= 0 ? points[k].data() : f.added[-k - 1].data());
+}
+
+static pair<point_k, point_k> segment_key(point_k a, point_k b)
+{
+    return a < b ? make_pair(a, b) : make_pair(b, a);
+}
+
+// Return the piece of f with the directed edge ab, or -1.
+static int find_edge(facet const& f, point_k a, point_k b)
+{
+    for (size_t i = 0; i < f.pieces.size(); ++i)
+    {
+        triangle const& t = f.pieces[i];
+        for (int j = 0; j < 3; ++j)
+        {
+            if (t[j] == a && t[(j + 1) % 3] == b)
+                return i;
+        }
+    }
+    return -1;
+}
+
+// Add point p to the pieces of f, from the piece start holding p: remove the pieces
+// whose circumcircle holds p, across the edges between pieces, and join p to the
+// edges around them but skip, the edge p is on if it splits a segment.
+static void insert_in_facet(vector<xyz> const& points, facet& f, point_k p, int start, pair<point_k, point_k> skip)
+{
+    REAL* apex = f.apex.data();
+    REAL* q = pos(points, f, p);
+    vector<int> cavity(1, start);
+    vector<pair<point_k, point_k> > boundary;
+    for (size_t k = 0; k < cavity.size(); ++k)
+    {
+        triangle t = f.pieces[cavity[k]];
+        for (int j = 0; j < 3; ++j)
+        {
+            point_k u = t[j];
+            point_k v = t[(j + 1) % 3];
+            int n = find_edge(f, v, u);
+            if (n != -1 && find(cavity.begin(), cavity.end(), n) != cavity.end())
+                continue;
+            // the sphere through a piece and apex cuts the plane in its circumcircle
+            if (n != -1 && insphere(pos(points, f, f.pieces[n][0]), pos(points, f, f.pieces[n][1]),
+                    pos(points, f, f.pieces[n][2]), apex, q) > 0)
+                cavity.push_back(n);
+            else if (make_pair(u, v) != skip)
+                boundary.push_back(make_pair(u, v));
+        }
+    }
+    sort(cavity.rbegin(), cavity.rend());
+    for (auto&& i : cavity)
+    {
+        f.pieces[i] = f.pieces.back();
+        f.pieces.pop_back();
+    }
+    for (auto&& e : boundary)
+    {
+        triangle t = {e.first, e.second, p};
+        f.pieces.push_back(t);
+    }
+}
+
+// Return true iff the tetras around a, found from the live tetra t, have one with b,
+// and with c unless it is -1.
+static bool has_simplex(triangulator const& tri, tetra_k t, point_k a, point_k b, point_k c)
+{
+    if (t == -1 || a < 0 || b < 0)
+        return false;
+    span<tetra const> tetras = tri.tetras();
+    span<tetra_neighbors const> neighbors = tri.neighbors();
+    vector<tetra_k> star(1, t);
+    for (size_t k = 0; k < star.size(); ++k)
+    {
+        tetra const& v = tetras[star[k]];
+        if (find(v.begin(), v.end(), b) != v.end() && (c == -1 || find(v.begin(), v.end(), c) != v.end()))
+            return true;
+        for (int i = 0; i < 4; ++i)
+        {
+            tetra_k n = neighbors[star[k]][i];
+            if (v[i] == a || n < 0 || find(star.begin(), star.end(), n) != star.end())
+                continue;
+            star.push_back(n);
+        }
+    }
+    return false;
+}
+
+// Circumcenter of the triangle abc, in its plane.
+static xyz circumcenter(REAL const* a, REAL const* b, REAL const* c)
+{
+    xyz e1 = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    xyz e2 = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    xyz n = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+    REAL len1 = e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2];
+    REAL len2 = e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2];
+    REAL norm = 2 * (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    xyz u = {e2[1] * n[2] - e2[2] * n[1], e2[2] * n[0] - e2[0] * n[2], e2[0] * n[1] - e2[1] * n[0]};
+    xyz v = {n[1] * e1[2] - n[2] * e1[1], n[2] * e1[0] - n[0] * e1[2], n[0] * e1[1] - n[1] * e1[0]};
+    xyz ret;
+    for (int k = 0; k < 3; ++k)
+        ret[k] = a[k] + (len1 * u[k] + len2 * v[k]) / norm;
+    return ret;
+}
+
+// Refine the pieces of f the tetras miss: add the circumcenter of each, unless it is
+// outside f or inside the diametral sphere of an edge of f, which is then requested
+// to be split instead and ends the refinement for this round.
+static void refine_facet(triangulator const& tri, vector<tetra_k> const& incident, vector<xyz> const& points,
+    segment_map const& by_key, facet& f)
+{
+    REAL* apex = f.apex.data();
+    vector<triangle> missing;
+    for (auto&& t : f.pieces)
+    {
+        if (!has_simplex(tri, incident[t[0]], t[0], t[1], t[2]))
+            missing.push_back(t);
+    }
+    for (auto&& t : missing)
+    {
+        if (find(f.pieces.begin(), f.pieces.end(), t) == f.pieces.end())
+            continue;
+        xyz c = circumcenter(pos(points, f, t[0]), pos(points, f, t[1]), pos(points, f, t[2]));
+        int start = -1;
+        for (size_t i = 0; i < f.pieces.size() && start == -1; ++i)
+        {
+            triangle const& s = f.pieces[i];
+            bool in = true;
+            for (int j = 0; j < 3 && in; ++j)
+                in = orient3d(pos(points, f, s[j]), pos(points, f, s[(j + 1) % 3]), apex, c.data()) <= 0;
+            if (in)
+                start = i;
+        }
+        // the edges of f are the edges of a single piece
+        size_t request = size_t(-1);
+        REAL farthest = 0;
+        for (auto&& s : f.pieces)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                point_k u = s[j];
+                point_k v = s[(j + 1) % 3];
+                if (find_edge(f, v, u) != -1)
+                    continue;
+                REAL* pu = pos(points, f, u);
+                REAL* pv = pos(points, f, v);
+                REAL dot = 0;
+                REAL len = 0;
+                for (int k = 0; k < 3; ++k)
+                {
+                    dot += (pu[k] - c[k]) * (pv[k] - c[k]);
+                    len += (pu[k] - pv[k]) * (pu[k] - pv[k]);
+                }
+                // split the longest edge encroached, or of the piece if c is outside f
+                bool own = start == -1 && find(t.begin(), t.end(), u) != t.end() && find(t.begin(), t.end(), v) != t.end();
+                if ((dot < 0 || own) && len > farthest)
+                {
+                    auto it = by_key.find(segment_key(u, v));
+                    if (it == by_key.end())
+                        continue;
+                    request = it->second;
+                    farthest = len;
+                }
+            }
+        }
+        if (request != size_t(-1))
+        {
+            f.requests.push_back(request);
+            return;
+        }
+        if (start == -1)
+        {
+            // c is outside f but near no edge of it, take the centroid
+            for (int k = 0; k < 3; ++k)
+                c[k] = (pos(points, f, t[0])[k] + pos(points, f, t[1])[k] + pos(points, f, t[2])[k]) / 3;
+            start = find(f.pieces.begin(), f.pieces.end(), t) - f.pieces.begin();
+        }
+        f.added.push_back(c);
+        insert_in_facet(points, f, -point_k(f.added.size()), start, make_pair(-1, -1));
+    }
+}
+
+// Split the segments at their middle, adding the points to points, and add the points
+// to the pieces of the facets around the segments.
+static void split_segments(vector<size_t> const& splits, vector<segment>& segments, segment_map& by_key,
+    vector<facet>& facets, vector<xyz>& points, tbb::task_arena& arena)
+{
+    vector<vector<array<point_k, 3> > > facet_splits(facets.size());
+    for (auto&& s : splits)
+    {
+        point_k a = segments[s].a;
+        point_k b = segments[s].b;
+        xyz mid;
+        for (int k = 0; k < 3; ++k)
+            mid[k] = 0.5 * (points[a][k] + points[b][k]);
+        point_k m = points.size();
+        points.push_back(mid);
+        for (auto&& f : segments[s].facets)
+        {
+            array<point_k, 3> split = {a, b, m};
+            facet_splits[f].push_back(split);
+        }
+        segment right = {m, b, segments[s].facets};
+        by_key.erase(segment_key(a, b));
+        segments[s].b = m;
+        by_key[segment_key(a, m)] = s;
+        by_key[segment_key(m, b)] = segments.size();
+        segments.push_back(right);
+    }
+    arena.execute([&] {
+        tbb::parallel_for(size_t(0), facets.size(), [&](size_t i) {
+            for (auto&& split : facet_splits[i])
+            {
+                facet& f = facets[i];
+                pair<point_k, point_k> edge(split[0], split[1]);
+                int start = find_edge(f, edge.first, edge.second);
+                if (start == -1)
+                {
+                    swap(edge.first, edge.second);
+                    start = find_edge(f, edge.first, edge.second);
+                }
+                if (start != -1)
+                    insert_in_facet(points, f, split[2], start, edge);
+            }
+        });
+    });
+}
+
+// Tag the tetras by side of the constraint faces, from the convex hull inwards.
+static void tag_sides(constrained_mesh& mesh)
+{
+    unordered_set<triangle, triangle_hash> constraints;
+    for (auto&& t : mesh.subfaces)
+    {
+        triangle key = t;
+        sort(key.begin(), key.end());
+        constraints.insert(key);
+    }
+    auto face = [&](tetra_k t, int i) {
+        triangle key;
+        for (int j = 0, k = 0; j < 4; ++j)
+        {
+            if (j != i)
+                key[k++] = mesh.tetras[t][j];
+        }
+        sort(key.begin(), key.end());
+        return key;
+    };
+    // 2 until the side is known
+    size_t num = mesh.tetras.size();
+    mesh.inside.assign(num, 2);
+    deque<tetra_k> queue;
+    for (tetra_k t = 0; t < tetra_k(num); ++t)
+    {
+        for (int i = 0; i < 4 && mesh.inside[t] == 2; ++i)
+        {
+            if (mesh.neighbors[t][i] != -1)
+                continue;
+            mesh.inside[t] = constraints.count(face(t, i)) ? 1 : 0;
+            queue.push_back(t);
+        }
+    }
+    while (!queue.empty())
+    {
+        tetra_k t = queue.front();
+        queue.pop_front();
+        for (int i = 0; i < 4; ++i)
+        {
+            tetra_k n = mesh.neighbors[t][i];
+            if (n == -1 || mesh.inside[n] != 2)
+                continue;
+            mesh.inside[n] = constraints.count(face(t, i)) ? 1 - mesh.inside[t] : mesh.inside[t];
+            queue.push_back(n);
+        }
+    }
+}
+
+bool triangulate_constrained(span<xyz const> points, vector<triangle> const& faces,
+    constrained_mesh& mesh, int num_threads, int max_rounds)
+{
+    mesh = constrained_mesh();
+    mesh.points.assign(points.begin(), points.end());
+    vector<xyz>& pts = mesh.points;
+    if (num_threads <= 0)
+        num_threads = max(1, int(thread::hardware_concurrency()));
+    size_t max_points = (STEINER_POINTS_PER_INPUT + 1) * (points.size() + faces.size()) + 1024;
+    triangulator tri(num_threads, max_points);
+    tri.insert(points);
+    tbb::task_arena arena(num_threads);
+
+    // the segments and the facets of the constraint faces, flat faces are left out
+    bool ok = tri.tetras().size() != 0;
+    vector<segment> segments;
+    segment_map by_key;
+    vector<facet> facets;
+    vector<int> facet_of(faces.size(), -1);
+    for (size_t i = 0; i < faces.size() && ok; ++i)
+    {
+        triangle const& t = faces[i];
+        for (auto&& k : t)
+            ok = ok && k >= 0 && size_t(k) < points.size();
+        if (!ok)
+            break;
+        xyz const& a = pts[t[0]];
+        xyz const& b = pts[t[1]];
+        xyz const& c = pts[t[2]];
+        xyz e1 = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        xyz e2 = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        xyz n = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        REAL area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (area == 0)
+            continue;
+        facet f;
+        REAL len = sqrt(max(e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2], e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2]));
+        for (int k = 0; k < 3; ++k)
+            f.apex[k] = (a[k] + b[k] + c[k]) / 3 + n[k] / area * len;
+        if (orient3d(pts[t[0]].data(), pts[t[1]].data(), pts[t[2]].data(), f.apex.data()) < 0)
+        {
+            for (int k = 0; k < 3; ++k)
+                f.apex[k] -= 2 * n[k] / area * len;
+        }
+        f.pieces.push_back(t);
+        facet_of[i] = facets.size();
+        for (int j = 0; j < 3; ++j)
+        {
+            auto key = segment_key(t[j], t[(j + 1) % 3]);
+            auto it = by_key.find(key);
+            if (it == by_key.end())
+            {
+                it = by_key.insert(make_pair(key, segments.size())).first;
+                segment s = {key.first, key.second, vector<int>()};
+                segments.push_back(s);
+            }
+            segments[it->second].facets.push_back(facets.size());
+        }
+        facets.push_back(f);
+    }
+    vector<tetra_k> incident = tri.incident_tetras();
+    for (auto&& s : segments)
+        ok = ok && incident[s.a] != -1 && incident[s.b] != -1;
+
+    // each round either splits the missing segments or refines the missing pieces
+    bool recovered = false;
+    for (int round = 0; ok && round <= max_rounds; ++round)
+    {
+        if (round > 0)
+            incident = tri.incident_tetras();
+        vector<char> missing(segments.size());
+        arena.execute([&] {
+            tbb::parallel_for(size_t(0), segments.size(), [&](size_t s) {
+                missing[s] = !has_simplex(tri, incident[segments[s].a], segments[s].a, segments[s].b, -1);
+            });
+        });
+        vector<size_t> splits;
+        for (size_t s = 0; s < segments.size(); ++s)
+        {
+            if (missing[s])
+                splits.push_back(s);
+        }
+        size_t first = pts.size();
+        if (splits.empty())
+        {
+            arena.execute([&] {
+                tbb::parallel_for(size_t(0), facets.size(), [&](size_t i) {
+                    refine_facet(tri, incident, pts, by_key, facets[i]);
+                });
+            });
+            // number the points added inside the facets
+            for (auto&& f : facets)
+            {
+                point_k base = pts.size();
+                pts.insert(pts.end(), f.added.begin(), f.added.end());
+                for (auto&& t : f.pieces)
+                {
+                    for (auto&& k : t)
+                    {
+                        if (k < 0)
+                            k = base - k - 1;
+                    }
+                }
+                f.added.clear();
+                splits.insert(splits.end(), f.requests.begin(), f.requests.end());
+                f.requests.clear();
+            }
+            sort(splits.begin(), splits.end());
+            splits.erase(unique(splits.begin(), splits.end()), splits.end());
+            mesh.num_facet_points += pts.size() - first;
+        }
+        mesh.num_segment_points += splits.size();
+        split_segments(splits, segments, by_key, facets, pts, arena);
+        if (pts.size() == first)
+        {
+            recovered = true;
+            break;
+        }
+        if (round == max_rounds || pts.size() > max_points)
+            break;
+        tri.insert(span<xyz const>(pts.data() + first, pts.size() - first));
+    }
+
+    tetra_mesh out = tri.compact();
+    mesh.tetras.swap(out.tetras);
+    mesh.neighbors.swap(out.neighbors);
+    mesh.subface_offsets.assign(1, 0);
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+        if (facet_of[i] != -1)
+        {
+            auto&& pieces = facets[facet_of[i]].pieces;
+            mesh.subfaces.insert(mesh.subfaces.end(), pieces.begin(), pieces.end());
+        }
+        mesh.subface_offsets.push_back(mesh.subfaces.size());
+    }
+    tag_sides(mesh);
+    return recovered;
+}
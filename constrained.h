@@ -0,0 +1,43 @@
+#ifndef CONSTRAINED_H
+
+#define CONSTRAINED_H
+
+#include <vector>
+#include "types.h"
+
+// A Delaunay tetrahedralization conforming to constraint faces, for volumes bounded
+// by surface meshes. Steiner points are added on the constraints until every one of
+// them is a union of faces of the tetras, and the tetras are tagged by the side of
+// the surface they are on.
+struct constrained_mesh {
+	// the input points, then the Steiner points added on the constraints
+	std::vector<xyz> points;
+	// finite tetras and their neighbors, as given by triangulator::compact()
+	std::vector<tetra> tetras;
+	std::vector<tetra_neighbors> neighbors;
+	// 1 for the tetras inside the surface, 0 outside: crossing a constraint face
+	// changes side, the tetras on the convex hull off the constraints are outside
+	std::vector<char> inside;
+	// the faces of the tetras making up constraint face f: subfaces[subface_offsets[f]]
+	// to subfaces[subface_offsets[f + 1]], oriented like f
+	std::vector<size_t> subface_offsets;
+	std::vector<triangle> subfaces;
+	// Steiner points added on the edges of the constraints and inside them
+	size_t num_segment_points;
+	size_t num_facet_points;
+
+	constrained_mesh() : num_segment_points(0), num_facet_points(0) {}
+};
+
+// Triangulate points and recover the constraint faces, triangles of point keys.
+// Each round the constraint edges missing from the tetras are split at their middle,
+// or once none is missing, each missing piece of a constraint face gets its in-plane
+// circumcenter, or splits the edge of the face that circumcenter is too close to.
+// The constraint faces are recovered in parallel and the Steiner points of a round
+// inserted as one batch. Runs on num_threads threads, 0 for all cores. Return false
+// if the constraints are not recovered after max_rounds, or reference points that
+// are not vertices (duplicates or all points coplanar); mesh is filled either way.
+bool triangulate_constrained(span<xyz const> points, std::vector<triangle> const& faces,
+	constrained_mesh& mesh, int num_threads = 0, int max_rounds = 64);
+
+#endif
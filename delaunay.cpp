@@ -8,11 +8,17 @@
 #include <cstdlib>
 //#include <stdlib.h>
 #include <chrono>
+#include <cstring>
 
 int num_points; 
 #include "predicates.h"
 #include "types.h"
 #include "triangulator.h"
+#include "mesh_io.h"
+#include "point_io.h"
+#include "streaming.h"
+#include "validate.h"
+#include "voronoi.h"
 // ------------- For drawing ---------------
 #define OPENGL
 #ifdef OPENGL
@@ -77,16 +83,19 @@ inline std::vector<xyz> generate_xyzs(size_t num) {
 	return ret;
 }
 
-std::vector<xyz> xyzs;
+// The points, either generated or viewing a loaded point cloud.
+span<xyz const> xyzs;
+std::vector<xyz> generated_xyzs;
+point_cloud loaded_xyzs;
 std::vector<tetra> tetras;
 triangulator* g_triangulator;
 
-// Output the tetras. Maybe write to file or draw them?
-inline void output_tetras(std::vector<tetra> const& tetras) {
-    for (auto&& t : tetras)
-    {
-        cout << t[0] << t[1] << t[2] << t[3] << endl; 
-    }
+// Output the tetras to a binary mesh, or to a VTK file if the path ends with .vtu.
+inline bool output_tetras(std::string const& path, std::vector<tetra> const& tetras) {
+    span<tetra const> cells(tetras.data(), tetras.size());
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".vtu") == 0)
+        return write_vtu(path, xyzs, cells);
+    return write_mesh(path, xyzs, cells, span<tetra_neighbors const>());
 }
 
 
@@ -99,16 +108,6 @@ std::vector<gl::vertex> draw(double time)
     int n = 0;
     for (auto&& t : tetras)
     {
-        bool skip = false;
-        for (auto&& key : t)
-        {
-            if(key >= num_points)
-                skip = true;
-        }
-        if(skip)
-            continue;
-
-        
         //std::cout << ++n << std::endl;
         std::array<vec3, 4> tetra_points;
 
@@ -160,68 +159,145 @@ std::vector<gl::vertex> draw(double time)
 #endif
 
 
-void check_correctness(std::vector<tetra>& tetras)
+// Validate the triangulation with its adjacency, see validate.h.
+void check_correctness(triangulator& tri)
 {
-    cout << "Checking correctness ..."; 
-    for (int i = 0; i < tetras.size(); i++)
-    {
-        tetra t1 = tetras[i];
-        if (t1[0] >= xyzs.size() |
-            t1[1] >= xyzs.size() |
-            t1[2] >= xyzs.size() |
-            t1[3] >= xyzs.size()) 
-            continue;
+    cout << "Checking correctness ..." << endl;
+    tetra_mesh mesh = tri.compact();
+    validation_report report;
+    bool ok = validate_mesh(xyzs, span<tetra const>(mesh.tetras.data(), mesh.tetras.size()),
+        span<tetra_neighbors const>(mesh.neighbors.data(), mesh.neighbors.size()), report);
+    report.write_text(cout);
+    if (!ok)
+        exit(1);
+}
 
 
-        for (int j = 0; j < tetras.size(); j++)
-        {
-            tetra t2 = tetras[j];
-
-            if (i == j)
-                continue;
-
-            if (t2[0] >= xyzs.size() |
-                t2[1] >= xyzs.size() |
-                t2[2] >= xyzs.size() |
-                t2[3] >= xyzs.size()) 
-                continue;
-
-            for (int k = 0; k < 4; k++)
-            {
-                assert(intetra( xyzs[t1[0]].data(),
-                                xyzs[t1[1]].data(),
-                                xyzs[t1[2]].data(),
-                                xyzs[t1[3]].data(),
-                                xyzs[t2[k]].data()) != 1);
-                assert(insphere( xyzs[t1[0]].data(),
-                                xyzs[t1[1]].data(),
-                                xyzs[t1[2]].data(),
-                                xyzs[t1[3]].data(),
-                                xyzs[t2[k]].data()) != 1);
-            }
-        }
+void CheckParams(int argc, char *argv[])
+{
+    if (argc != 3 && argc != 4)
+    {
+        fprintf(stderr, "bad parameters: ./delaunay [num_points/points file] [0/1:display tetras] [output.tmsh/.vtu]\n");
+        exit(1);
     }
-    cout << " passed" << endl;
 }
 
+// ./delaunay --stream [points file] [output.tmsh] [points per cell]
+int stream_main(int argc, char *argv[])
+{
+    stream_options options;
+    if (argc == 5)
+        options.cell_points = strtoul(argv[4], nullptr, 10);
+    stream_stats stats;
+    cout << "Streaming " << argv[2] << " to " << argv[3] << "..." << endl;
+    auto start_time = chrono::steady_clock::now();
+    if (!stream_triangulate(argv[2], argv[3], options, &stats))
+    {
+        fprintf(stderr, "failed to stream %s to %s\n", argv[2], argv[3]);
+        return 1;
+    }
+    auto end_time = chrono::steady_clock::now();
+    double time = 0.001 * chrono::duration_cast<chrono::milliseconds>
+        (end_time - start_time).count();
+    cout << "Number of points: " << stats.num_points << endl;
+    cout << "Number of tetras: " << stats.num_tetras << endl;
+    cout << "Number of cells: " << stats.num_cells << endl;
+    cout << "Peak tetra slots: " << stats.peak_tetras << endl;
+    cout << "Peak resident points: " << stats.peak_points << endl;
+    cout << "Execution Time: " << time << endl;
+    return 0;
+}
 
-void CheckParams(int argc, char *argv[])
+// ./delaunay --validate [mesh.tmsh with neighbors], exits with 1 if the mesh is not valid
+int validate_main(int argc, char *argv[])
 {
-    if (argc != 3)
+    mesh_data mesh;
+    if (!read_mesh(argv[2], mesh))
     {
-        fprintf(stderr, "bad parameters: ./delaunay [num_points] [0/1:display tetras]\n");
-        exit(1);
+        fprintf(stderr, "failed to read %s\n", argv[2]);
+        return 1;
+    }
+    cout << "Validating " << argv[2] << "..." << endl;
+    auto start_time = chrono::steady_clock::now();
+    validation_report report;
+    bool ok = validate_mesh(span<xyz const>(mesh.points.data(), mesh.points.size()),
+        span<tetra const>(mesh.tetras.data(), mesh.tetras.size()),
+        span<tetra_neighbors const>(mesh.neighbors.data(), mesh.neighbors.size()), report);
+    auto end_time = chrono::steady_clock::now();
+    report.write_text(cout);
+    cout << "Execution Time: " << 0.001 * chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count() << endl;
+    return ok ? 0 : 1;
+}
+
+// ./delaunay --voronoi [mesh.tmsh with neighbors], prints the sizes of the Voronoi diagram
+int voronoi_main(int argc, char *argv[])
+{
+    mesh_data mesh;
+    if (!read_mesh(argv[2], mesh))
+    {
+        fprintf(stderr, "failed to read %s\n", argv[2]);
+        return 1;
+    }
+    cout << "Building the Voronoi diagram of " << argv[2] << "..." << endl;
+    auto start_time = chrono::steady_clock::now();
+    voronoi_diagram diagram;
+    if (!compute_voronoi(span<xyz const>(mesh.points.data(), mesh.points.size()),
+        span<tetra const>(mesh.tetras.data(), mesh.tetras.size()),
+        span<tetra_neighbors const>(mesh.neighbors.data(), mesh.neighbors.size()), diagram))
+    {
+        fprintf(stderr, "%s has no neighbors\n", argv[2]);
+        return 1;
     }
+    auto end_time = chrono::steady_clock::now();
+    size_t num_bounded = 0;
+    REAL volume = 0;
+    for (auto&& v : diagram.cell_volumes)
+    {
+        if (v > 0 && v < numeric_limits<REAL>::infinity())
+        {
+            ++num_bounded;
+            volume += v;
+        }
+    }
+    cout << "Number of vertices: " << diagram.vertices.size() << endl;
+    cout << "Number of faces: " << diagram.num_faces() / 2 << endl;
+    cout << "Number of bounded cells: " << num_bounded << " of " << mesh.points.size() << endl;
+    cout << "Volume of the bounded cells: " << volume << endl;
+    cout << "Execution Time: " << 0.001 * chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count() << endl;
+    return 0;
 }
 
 int main(int argc, char *argv[])
 {
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--stream") == 0)
+        return stream_main(argc, argv);
+    if (argc == 3 && strcmp(argv[1], "--validate") == 0)
+        return validate_main(argc, argv);
+    if (argc == 3 && strcmp(argv[1], "--voronoi") == 0)
+        return voronoi_main(argc, argv);
     CheckParams(argc, argv);
 
-	num_points = atoi(argv[1]);
+    char* end;
+	num_points = strtol(argv[1], &end, 10);
+    if (*end == 0)
+    {
+        cout << "Generating points..." << endl;
+        generated_xyzs = generate_xyzs(num_points);
+        xyzs = span<xyz const>(generated_xyzs.data(), generated_xyzs.size());
+    }
+    else
+    {
+        cout << "Loading " << argv[1] << "..." << endl;
+        if (!load_points(argv[1], loaded_xyzs))
+        {
+            fprintf(stderr, "failed to load %s\n", argv[1]);
+            exit(1);
+        }
+        spatial_sort(loaded_xyzs.points());
+        xyzs = loaded_xyzs.points();
+        num_points = xyzs.size();
+    }
 	cout << "Number of points: " << num_points << endl;
-	cout << "Generating points..." << endl;
-    xyzs = generate_xyzs(num_points);
     int thread_numbers[] = {1, 2, 3, 4};
 	for (int i = 0; i < sizeof(thread_numbers) / sizeof(thread_numbers[0]); ++i) {
 		int num_thread = thread_numbers[i];
@@ -234,6 +310,10 @@ int main(int argc, char *argv[])
 			triangulator g_triangulator(xyzs, num_thread);
 			tetras = g_triangulator.triangulate();
 			num_jobs += g_triangulator.get_num_jobs();
+			STATS(g_triangulator.stats().write_text(cout));
+#ifdef CHECK_CORRECTNESS
+			check_correctness(g_triangulator);
+#endif
 		}
 		auto end_time = chrono::steady_clock::now();
 		double time = 0.001 * chrono::duration_cast<chrono::milliseconds>
@@ -246,10 +326,12 @@ int main(int argc, char *argv[])
 	}
     //cout << "tetras.size = " <<  tetras.size() << endl;
 
-
-#ifdef CHECK_CORRECTNESS
-    check_correctness(tetras);
-#endif
+    if (argc == 4)
+    {
+        cout << "Writing " << argv[3] << "..." << endl;
+        if (!output_tetras(argv[3], tetras))
+            fprintf(stderr, "failed to write %s\n", argv[3]);
+    }
 
 
 
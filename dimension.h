@@ -0,0 +1,122 @@
+#pragma once
+
+#include "types.h"
+
+// STL
+#include <cmath>
+
+// The predicates of predicates.c read doubles. A float widens to a double exactly, so
+// the coordinates of float points are copied to buf and tested as exactly as doubles;
+// double points are read in place. Picked at compile time by the coordinate type.
+inline REAL* exact_coords(double* p, REAL*) {
+	return p;
+}
+inline REAL* exact_coords(float* p, REAL* buf) {
+	buf[0] = p[0];
+	buf[1] = p[1];
+	buf[2] = p[2];
+	return buf;
+}
+
+// What the triangulator needs to know about the dimension D it triangulates in: the
+// faces of a simplex and the predicates on them. Points are always 3 coordinates of
+// type T, a 2D triangulation reads their x and y only, so the heights of a terrain
+// ride along.
+template <int D>
+struct dimension;
+
+template <>
+struct dimension<3> {
+	// facet(i, j) is the index of point j of the face opposite point i of a tetra.
+	// The face is ordered so that point i is on its positive side.
+	static int facet(int i, int j) {
+		static int const facets[4][3] = {{1, 3, 2}, {0, 2, 3}, {0, 3, 1}, {0, 1, 2}};
+		return facets[i][j];
+	}
+
+	// Positive if q is on the positive side of the face f, 0 on its plane.
+	template <typename T>
+	static REAL orient(T* const f[3], T* q) {
+		REAL b[4][3];
+		return orient3d(exact_coords(f[0], b[0]), exact_coords(f[1], b[1]), exact_coords(f[2], b[2]), exact_coords(q, b[3]));
+	}
+
+	// Positive if q is inside the circumsphere of the positively oriented tetra p.
+	template <typename T>
+	static REAL insphere(T* const p[4], T* q) {
+		REAL b[5][3];
+		return ::insphere(exact_coords(p[0], b[0]), exact_coords(p[1], b[1]), exact_coords(p[2], b[2]),
+			exact_coords(p[3], b[3]), exact_coords(q, b[4]));
+	}
+	template <typename T>
+	static REAL powertest(T* const p[4], REAL const w[4], T* q, REAL wq) {
+		REAL b[5][3];
+		return ::powertest(exact_coords(p[0], b[0]), exact_coords(p[1], b[1]), exact_coords(p[2], b[2]),
+			exact_coords(p[3], b[3]), exact_coords(q, b[4]), w[0], w[1], w[2], w[3], wq);
+	}
+
+	// Side j of the cone from o through the face f, the face on its positive side.
+	// Crossing it leads to the infinite tetra across the face edge opposite point
+	// cone_opposite(j) of f.
+	template <typename T>
+	static REAL cone_side(T* o, T* const f[3], int j, T* q) {
+		REAL b[4][3];
+		return orient3d(exact_coords(o, b[0]), exact_coords(f[j], b[1]), exact_coords(f[(j + 1) % 3], b[2]), exact_coords(q, b[3]));
+	}
+	static int cone_opposite(int j) {
+		return (j + 2) % 3;
+	}
+
+	// A measure of the spread of q from the first k points of p, 2 <= k <= 3: its
+	// distance to their line or plane times their length or area, up to a constant.
+	template <typename T>
+	static REAL spread(T* const p[], int k, T* q) {
+		if (k == 3) return std::fabs(orient(p, q));
+		REAL u[3] = {REAL(p[1][0]) - p[0][0], REAL(p[1][1]) - p[0][1], REAL(p[1][2]) - p[0][2]};
+		REAL v[3] = {REAL(q[0]) - p[0][0], REAL(q[1]) - p[0][1], REAL(q[2]) - p[0][2]};
+		REAL w[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+		return w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+	}
+};
+
+template <>
+struct dimension<2> {
+	static int facet(int i, int j) {
+		static int const facets[3][2] = {{1, 2}, {2, 0}, {0, 1}};
+		return facets[i][j];
+	}
+
+	// Positive if q is left of the edge f.
+	template <typename T>
+	static REAL orient(T* const f[2], T* q) {
+		REAL b[3][3];
+		return orient2d(exact_coords(f[0], b[0]), exact_coords(f[1], b[1]), exact_coords(q, b[2]));
+	}
+
+	template <typename T>
+	static REAL insphere(T* const p[3], T* q) {
+		REAL b[4][3];
+		return incircle(exact_coords(p[0], b[0]), exact_coords(p[1], b[1]), exact_coords(p[2], b[2]), exact_coords(q, b[3]));
+	}
+	// Weighted triangulations are 3D only, a 2D one never has weights.
+	template <typename T>
+	static REAL powertest(T* const p[3], REAL const*, T* q, REAL) {
+		return insphere(p, q);
+	}
+
+	// The sides of the cone are the half lines from o through the points of the edge.
+	template <typename T>
+	static REAL cone_side(T* o, T* const f[2], int j, T* q) {
+		REAL b[3][3];
+		return j == 0 ? orient2d(exact_coords(f[0], b[0]), exact_coords(o, b[1]), exact_coords(q, b[2]))
+			: orient2d(exact_coords(o, b[0]), exact_coords(f[1], b[1]), exact_coords(q, b[2]));
+	}
+	static int cone_opposite(int j) {
+		return 1 - j;
+	}
+
+	template <typename T>
+	static REAL spread(T* const p[], int, T* q) {
+		return std::fabs(orient(p, q));
+	}
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <deque>
 #include <mutex>
@@ -8,6 +9,7 @@
 #include <vector>
 #include <condition_variable>
 #include <boost/heap/fibonacci_heap.hpp>
+#include "stats.h"
 using boost::heap::fibonacci_heap;
 typedef std::function<void ()> job_type;
 
@@ -26,28 +28,78 @@ struct heap_data {
 
 class job_queue {
 public:
-	job_queue(int num_thread) : unfinished_jobs_(0), num_thread_(num_thread), num_jobs_(0) {}
-	void push_job(job_type job) {
+	// Jobs pushed without a priority get a random one below RANDOM_PRIORITIES.
+	static int const RANDOM_PRIORITIES = 1000001;
+
+	job_queue(int num_thread) : unfinished_jobs_(0), num_thread_(num_thread), num_jobs_(0), wait_cycles_(0), cancelled_(false), paused_(false) {}
+	// Queue a job. Jobs of higher priority are taken first.
+	void push_job(job_type job, int priority = -1) {
 		
 		//heap_data h_data(rand()%100000001,std::move(job));
 
 		lock_t lock(mutex_);
-		insert_job(std::move(job));
+		insert_job(std::move(job), priority);
 		++unfinished_jobs_;
 		++num_jobs_;
 	}
-	void run_jobs() {
+	// Run the jobs on num_thread workers, 0 for the number the queue was made with.
+	// A single worker runs on the calling thread.
+	void run_jobs(int num_thread = 0) {
+		if (num_thread <= 0) num_thread = num_thread_;
+		if (num_thread == 1) {
+			functor(this, 0)();
+			worker_id() = -1;
+			return;
+		}
 		std::vector<std::thread> threads;
-		for (int id = 0; id < num_thread_; ++id) {
+		for (int id = 0; id < num_thread; ++id) {
 			threads.emplace_back(functor(this, id));
 		}
-		for (int id = 0; id < num_thread_; ++id) {
+		for (int id = 0; id < num_thread; ++id) {
 			threads[id].join();
 		}
 	}
 	int get_num_jobs() const {
 		return num_jobs_;
 	}
+	// From then on the workers drop the jobs they take instead of running them, so
+	// run_jobs() returns once the jobs running are done. Thread safe.
+	void cancel() {
+		cancelled_.store(true, std::memory_order_relaxed);
+	}
+	bool cancelled() const {
+		return cancelled_.load(std::memory_order_relaxed);
+	}
+	// From then on the workers take no more jobs, so run_jobs() returns once the jobs
+	// running are done, leaving the others queued until resume(). Thread safe.
+	void pause() {
+		lock_t lock(mutex_);
+		paused_ = true;
+		cond_var_.notify_all();
+	}
+	// Let the next run_jobs() take the jobs left by pause(). Not while jobs run.
+	void resume() {
+		lock_t lock(mutex_);
+		paused_ = false;
+	}
+	// Drop the jobs queued, and a pause. Not while jobs run.
+	void clear() {
+		lock_t lock(mutex_);
+		jobs_.clear();
+		unfinished_jobs_ = 0;
+		paused_ = false;
+	}
+	// Index of the worker running jobs on the calling thread, -1 outside of run_jobs().
+	static int current_worker() {
+		return worker_id();
+	}
+	// Return the stats_clock() ticks workers spent waiting for jobs since the last
+	// call. Only counted with TRIANGULATOR_STATS.
+	uint64_t take_wait_cycles() {
+		uint64_t ret = wait_cycles_;
+		wait_cycles_ = 0;
+		return ret;
+	}
 	~job_queue() {
 //		std::cout << "num_jobs: " << num_jobs_ << std::endl;
 	}
@@ -58,14 +110,20 @@ private:
 		functor(job_queue* thiz, int id) : thiz_(thiz), id_(id) {
 		}
 		void operator()() {
+			worker_id() = id_;
+			STATS(uint64_t wait_cycles = 0);
 			job_type job;
 			for (;;) {
 				size_t queue_size = 0;
 //				bool should_sleep = false;
+				STATS(uint64_t wait_start = stats_clock());
 				{
 					lock_t lock(thiz_->mutex_);
 					for (;;) {
-						if (thiz_->unfinished_jobs_ == 0) return;
+						if (thiz_->unfinished_jobs_ == 0 || thiz_->paused_) {
+							STATS(thiz_->wait_cycles_ += wait_cycles + stats_clock() - wait_start);
+							return;
+						}
 						if (thiz_->jobs_.size() > 50) break;
 						if (!thiz_->jobs_.empty() && id_ == 0) break;
 						thiz_->cond_var_.wait(lock);
@@ -74,21 +132,25 @@ private:
 //					if (thiz_->jobs_.size() < 100) should_sleep = true;
 					queue_size = thiz_->jobs_.size();
 				}
+				STATS(wait_cycles += stats_clock() - wait_start);
 //				std::cout << "Queue Size: " << queue_size << std::endl;
-				job();
+				if (!thiz_->cancelled()) job();
 //				std::this_thread::sleep_for(std::chrono::milliseconds(0));
 				{
 					lock_t lock(thiz_->mutex_);
 					--thiz_->unfinished_jobs_;
+					// a worker other than 0 leaving a short queue behind must wake
+					// worker 0, which may be waiting for jobs only it will take
 					if (thiz_->unfinished_jobs_ == 0
-						|| thiz_->jobs_.size() > 100) thiz_->cond_var_.notify_all();
+						|| thiz_->jobs_.size() > 100
+						|| (id_ != 0 && !thiz_->jobs_.empty() && thiz_->jobs_.size() <= 50)) thiz_->cond_var_.notify_all();
 				}
 			}
 		}
 	};
-	void insert_job(job_type&& job) {
+	void insert_job(job_type&& job, int priority) {
 		
-		heap_data h_data(rand()%1000001,std::move(job));
+		heap_data h_data(priority >= 0 ? priority : rand()%RANDOM_PRIORITIES,std::move(job));
 		//jobs_.push_back(std::move(job));
 		jobs_.push(h_data);	
 	}
@@ -104,6 +166,10 @@ private:
 		jobs_.pop_front();
 		return job;*/
 	}
+	static int& worker_id() {
+		static thread_local int id = -1;
+		return id;
+	}
 	typedef std::mutex mutex_t;
 	typedef std::unique_lock<mutex_t> lock_t;
 	std::condition_variable cond_var_;
@@ -113,4 +179,7 @@ private:
 	int unfinished_jobs_;
 	int num_thread_;
 	int num_jobs_;
+	uint64_t wait_cycles_;
+	std::atomic<bool> cancelled_;
+	bool paused_;
 };
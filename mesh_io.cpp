@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+#include "mesh_io.h"
+using namespace std;
+
+
+// Raw bytes per chunk, a multiple of every element size.
+static size_t const CHUNK_BYTES = 3 << 18;
+
+static char const MAGIC[4] = {'T', 'M', 'S', 'H'};
+static uint32_t const VERSION = 1;
+
+struct mesh_header {
+	char magic[4];
+	uint32_t version;
+	uint64_t counts[3];
+};
+
+struct chunk_header {
+	uint32_t type;
+	uint32_t compressed;
+	uint64_t count;
+	uint64_t stored_size;
+};
+
+struct chunk {
+	size_t begin;
+	size_t size;
+	unsigned char const* raw;
+	vector<unsigned char> scratch;
+	vector<unsigned char> stored;
+	bool compressed;
+};
+
+// Compress num_bytes in chunks of CHUNK_BYTES, in parallel on num_threads threads.
+// raw(begin, end, scratch) returns the bytes [begin, end), possibly built in scratch.
+// emit(chunk) is called for each chunk in order, as soon as it and the chunks before
+// it are done, so the output streams while later chunks are still compressed.
+// Unless must_compress, a chunk that does not shrink is kept raw.
+template <typename Raw, typename Emit>
+static void compress_chunks(size_t num_bytes, int level, bool must_compress, int num_threads, Raw raw, Emit emit)
+{
+    size_t num_chunks = (num_bytes + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    size_t next = 0;
+    tbb::task_arena arena(num_threads > 0 ? num_threads : int(tbb::task_arena::automatic));
+    arena.execute([&] {
+        tbb::parallel_pipeline(4 * arena.max_concurrency(),
+            tbb::make_filter<void, chunk*>(tbb::filter_mode::serial_in_order,
+                [&](tbb::flow_control& fc) -> chunk* {
+                    if (next == num_chunks)
+                    {
+                        fc.stop();
+                        return nullptr;
+                    }
+                    chunk* c = new chunk;
+                    c->begin = next * CHUNK_BYTES;
+                    c->size = min(CHUNK_BYTES, num_bytes - c->begin);
+                    ++next;
+                    return c;
+                }) &
+            tbb::make_filter<chunk*, chunk*>(tbb::filter_mode::parallel,
+                [&](chunk* c) -> chunk* {
+                    c->raw = raw(c->begin, c->begin + c->size, c->scratch);
+                    c->compressed = false;
+                    if (level > 0 || must_compress)
+                    {
+                        uLongf stored_size = compressBound(c->size);
+                        c->stored.resize(stored_size);
+                        if (compress2(c->stored.data(), &stored_size, c->raw, c->size, level) == Z_OK &&
+                            (must_compress || stored_size < c->size))
+                        {
+                            c->stored.resize(stored_size);
+                            c->compressed = true;
+                        }
+                    }
+                    return c;
+                }) &
+            tbb::make_filter<chunk*, void>(tbb::filter_mode::serial_in_order,
+                [&](chunk* c) {
+                    emit(*c);
+                    delete c;
+                }));
+    });
+}
+
+mesh_writer::mesh_writer(string const& path, int level, int num_threads) :
+    os_(path.c_str(), ios::binary), level_(level), num_threads_(num_threads)
+{
+    fill(counts_, counts_ + 4, 0);
+    mesh_header header;
+    memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    fill(header.counts, header.counts + 3, 0);
+    os_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+}
+
+mesh_writer::~mesh_writer()
+{
+    if (os_.is_open())
+        close();
+}
+
+bool mesh_writer::good() const
+{
+    return os_.good();
+}
+
+void mesh_writer::write_points(span<xyz const> points)
+{
+    write_block(MESH_POINTS, reinterpret_cast<char const*>(points.data()), sizeof(xyz), points.size());
+}
+
+void mesh_writer::write_tetras(span<tetra const> tetras)
+{
+    write_block(MESH_TETRAS, reinterpret_cast<char const*>(tetras.data()), sizeof(tetra), tetras.size());
+}
+
+void mesh_writer::write_neighbors(span<tetra_neighbors const> neighbors)
+{
+    write_block(MESH_NEIGHBORS, reinterpret_cast<char const*>(neighbors.data()), sizeof(tetra_neighbors), neighbors.size());
+}
+
+bool mesh_writer::close()
+{
+    mesh_header header;
+    memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    copy(counts_ + 1, counts_ + 4, header.counts);
+    os_.seekp(0);
+    os_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    bool ok = os_.good();
+    os_.close();
+    return ok;
+}
+
+void mesh_writer::write_block(mesh_chunk_type type, char const* data, size_t elem_size, size_t num)
+{
+    counts_[type] += num;
+    compress_chunks(elem_size * num, level_, false, num_threads_,
+        [&](size_t begin, size_t, vector<unsigned char>&) {
+            return reinterpret_cast<unsigned char const*>(data + begin);
+        },
+        [&](chunk const& c) {
+            chunk_header header;
+            header.type = type;
+            header.compressed = c.compressed;
+            header.count = c.size / elem_size;
+            header.stored_size = c.compressed ? c.stored.size() : c.size;
+            os_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            os_.write(reinterpret_cast<char const*>(c.compressed ? c.stored.data() : c.raw), header.stored_size);
+        });
+}
+
+bool read_mesh(string const& path, mesh_data& mesh, int num_threads)
+{
+    ifstream is(path.c_str(), ios::binary);
+    mesh_header header;
+    if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION)
+        return false;
+
+    // read the stored chunks, then place them by their offsets in their block
+    struct stored_chunk {
+        chunk_header header;
+        uint64_t offset;
+        vector<unsigned char> payload;
+    };
+    vector<stored_chunk> chunks;
+    uint64_t counts[4] = {0, 0, 0, 0};
+    size_t const elem_sizes[4] = {0, sizeof(xyz), sizeof(tetra), sizeof(tetra_neighbors)};
+    for (;;)
+    {
+        stored_chunk c;
+        if (!is.read(reinterpret_cast<char*>(&c.header), sizeof(c.header)))
+            break;
+        if (c.header.type < MESH_POINTS || c.header.type > MESH_NEIGHBORS)
+            return false;
+        c.payload.resize(c.header.stored_size);
+        if (!is.read(reinterpret_cast<char*>(c.payload.data()), c.header.stored_size))
+            return false;
+        c.offset = counts[c.header.type];
+        counts[c.header.type] += c.header.count;
+        chunks.push_back(move(c));
+    }
+
+    mesh.points.resize(counts[MESH_POINTS]);
+    mesh.tetras.resize(counts[MESH_TETRAS]);
+    mesh.neighbors.resize(counts[MESH_NEIGHBORS]);
+    unsigned char* blocks[4] = {
+        nullptr,
+        reinterpret_cast<unsigned char*>(mesh.points.data()),
+        reinterpret_cast<unsigned char*>(mesh.tetras.data()),
+        reinterpret_cast<unsigned char*>(mesh.neighbors.data())
+    };
+    bool ok = true;
+    tbb::task_arena arena(num_threads > 0 ? num_threads : int(tbb::task_arena::automatic));
+    arena.execute([&] {
+        tbb::parallel_for(size_t(0), chunks.size(), [&](size_t i) {
+            auto&& c = chunks[i];
+            size_t elem_size = elem_sizes[c.header.type];
+            unsigned char* dest = blocks[c.header.type] + c.offset * elem_size;
+            uLongf raw_size = c.header.count * elem_size;
+            if (!c.header.compressed)
+            {
+                if (c.header.stored_size != raw_size)
+                    ok = false;
+                else
+                    memcpy(dest, c.payload.data(), raw_size);
+            }
+            else if (uncompress(dest, &raw_size, c.payload.data(), c.payload.size()) != Z_OK ||
+                     raw_size != c.header.count * elem_size)
+            {
+                ok = false;
+            }
+        });
+    });
+    return ok;
+}
+
+bool write_mesh(string const& path, span<xyz const> points, span<tetra const> tetras,
+        span<tetra_neighbors const> neighbors, int level, int num_threads)
+{
+    mesh_writer writer(path, level, num_threads);
+    writer.write_points(points);
+    writer.write_tetras(tetras);
+    if (!neighbors.empty())
+        writer.write_neighbors(neighbors);
+    return writer.close();
+}
+
+// An appended VTK array compressed by vtkZLibDataCompressor: a header of
+// [number of blocks, block size, size of the last partial block, compressed
+// sizes of the blocks...] followed by the blocks.
+struct vtu_array {
+    vector<uint64_t> header;
+    vector<unsigned char> data;
+    size_t bytes() const
+    {
+        return header.size() * sizeof(uint64_t) + data.size();
+    }
+};
+
+template <typename Raw>
+static vtu_array compress_vtu_array(size_t num_bytes, int level, int num_threads, Raw raw)
+{
+    vtu_array ret;
+    ret.header.push_back((num_bytes + CHUNK_BYTES - 1) / CHUNK_BYTES);
+    ret.header.push_back(CHUNK_BYTES);
+    ret.header.push_back(num_bytes % CHUNK_BYTES);
+    compress_chunks(num_bytes, level, true, num_threads, raw, [&](chunk const& c) {
+        ret.header.push_back(c.stored.size());
+        ret.data.insert(ret.data.end(), c.stored.begin(), c.stored.end());
+    });
+    return ret;
+}
+
+bool write_vtu(string const& path, span<xyz const> points, span<tetra const> tetras,
+        int level, int num_threads)
+{
+    // connectivity is the tetras themselves, offsets and types are generated chunk by chunk
+    vtu_array arrays[4] = {
+        compress_vtu_array(points.size() * sizeof(xyz), level, num_threads,
+            [&](size_t begin, size_t, vector<unsigned char>&) {
+                return reinterpret_cast<unsigned char const*>(points.data()) + begin;
+            }),
+        compress_vtu_array(tetras.size() * sizeof(tetra), level, num_threads,
+            [&](size_t begin, size_t, vector<unsigned char>&) {
+                return reinterpret_cast<unsigned char const*>(tetras.data()) + begin;
+            }),
+        compress_vtu_array(tetras.size() * sizeof(int32_t), level, num_threads,
+            [&](size_t begin, size_t end, vector<unsigned char>& scratch) {
+                scratch.resize(end - begin);
+                int32_t* offsets = reinterpret_cast<int32_t*>(scratch.data());
+                for (size_t i = begin / sizeof(int32_t); i < end / sizeof(int32_t); ++i)
+                    *offsets++ = 4 * (i + 1);
+                return static_cast<unsigned char const*>(scratch.data());
+            }),
+        compress_vtu_array(tetras.size(), level, num_threads,
+            [&](size_t begin, size_t end, vector<unsigned char>& scratch) {
+                // VTK_TETRA
+                scratch.assign(end - begin, 10);
+                return static_cast<unsigned char const*>(scratch.data());
+            })
+    };
+    size_t offsets[4] = {0};
+    for (int i = 1; i < 4; ++i)
+        offsets[i] = offsets[i - 1] + arrays[i - 1].bytes();
+
+    ofstream os(path.c_str(), ios::binary);
+    os << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"LittleEndian\""
+       << " header_type=\"UInt64\" compressor=\"vtkZLibDataCompressor\">\n"
+       << "  <UnstructuredGrid>\n"
+       << "    <Piece NumberOfPoints=\"" << points.size() << "\" NumberOfCells=\"" << tetras.size() << "\">\n"
+       << "      <Points>\n"
+       << "        <DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\"" << offsets[0] << "\"/>\n"
+       << "      </Points>\n"
+       << "      <Cells>\n"
+       << "        <DataArray type=\"Int32\" Name=\"connectivity\" format=\"appended\" offset=\"" << offsets[1] << "\"/>\n"
+       << "        <DataArray type=\"Int32\" Name=\"offsets\" format=\"appended\" offset=\"" << offsets[2] << "\"/>\n"
+       << "        <DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"" << offsets[3] << "\"/>\n"
+       << "      </Cells>\n"
+       << "    </Piece>\n"
+       << "  </UnstructuredGrid>\n"
+       << "  <AppendedData encoding=\"raw\">\n"
+       << "   _";
+    for (auto&& array : arrays)
+    {
+        os.write(reinterpret_cast<char const*>(array.header.data()), array.header.size() * sizeof(uint64_t));
+        os.write(reinterpret_cast<char const*>(array.data.data()), array.data.size());
+    }
+    os << "\n  </AppendedData>\n"
+       << "</VTKFile>\n";
+    return os.good();
+}
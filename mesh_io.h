@@ -0,0 +1,67 @@
+#ifndef MESH_IO_H
+
+#define MESH_IO_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "types.h"
+
+// Binary mesh format, native little endian:
+//   header: "TMSH", version, number of points, tetras and neighbor records
+//   chunks: type, number of elements, raw size, stored size, payload
+// A chunk holds consecutive elements of one block (points, tetras or neighbors),
+// and the chunks of a block follow each other in file order, so blocks can be
+// written in pieces. A payload is zlib compressed unless that makes it larger.
+// The counts in the header are patched when the writer is closed.
+
+enum mesh_chunk_type {
+	MESH_POINTS = 1,
+	MESH_TETRAS = 2,
+	MESH_NEIGHBORS = 3
+};
+
+// Write a binary mesh. Chunks are compressed in parallel and written in order
+// as soon as they are done.
+class mesh_writer {
+public:
+	// level is the zlib level, 0 to store chunks uncompressed.
+	// num_threads is the number of compressing threads, 0 for all cores.
+	mesh_writer(std::string const& path, int level = 1, int num_threads = 0);
+	~mesh_writer();
+
+	bool good() const;
+	void write_points(span<xyz const> points);
+	void write_tetras(span<tetra const> tetras);
+	void write_neighbors(span<tetra_neighbors const> neighbors);
+	// Patch the header and close the file. Return false if some write failed.
+	bool close();
+
+private:
+	void write_block(mesh_chunk_type type, char const* data, size_t elem_size, size_t num);
+
+	std::ofstream os_;
+	int level_;
+	int num_threads_;
+	uint64_t counts_[4];
+};
+
+struct mesh_data {
+	std::vector<xyz> points;
+	std::vector<tetra> tetras;
+	std::vector<tetra_neighbors> neighbors;
+};
+
+// Read a binary mesh, decompressing chunks in parallel. Return false on a bad file.
+bool read_mesh(std::string const& path, mesh_data& mesh, int num_threads = 0);
+
+// Write a binary mesh in one go. neighbors may be empty.
+bool write_mesh(std::string const& path, span<xyz const> points, span<tetra const> tetras,
+		span<tetra_neighbors const> neighbors, int level = 1, int num_threads = 0);
+
+// Write a VTK XML unstructured grid of tetras, with zlib compressed appended data.
+bool write_vtu(std::string const& path, span<xyz const> points, span<tetra const> tetras,
+		int level = 1, int num_threads = 0);
+
+#endif /* end of include guard: MESH_IO_H */
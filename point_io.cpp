@@ -0,0 +1,501 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include "point_io.h"
+using namespace std;
+
+
+// Bytes of text parsed by one task.
+static size_t const TEXT_CHUNK = 1 << 22;
+// Points converted by one task.
+static size_t const POINT_CHUNK = 1 << 16;
+
+point_cloud::point_cloud() : map_(nullptr), map_size_(0)
+{
+}
+
+point_cloud::point_cloud(point_cloud&& other) : map_(nullptr), map_size_(0)
+{
+    *this = move(other);
+}
+
+point_cloud& point_cloud::operator=(point_cloud&& other)
+{
+    if (this == &other)
+        return *this;
+    reset();
+    map_ = other.map_;
+    map_size_ = other.map_size_;
+    owned_ = move(other.owned_);
+    points_ = other.points_;
+    other.map_ = nullptr;
+    other.map_size_ = 0;
+    other.points_ = span<xyz>();
+    return *this;
+}
+
+point_cloud::~point_cloud()
+{
+    reset();
+}
+
+void point_cloud::reset()
+{
+    if (map_)
+        munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    owned_.clear();
+    points_ = span<xyz>();
+}
+
+// Builds a point_cloud either as a view of its mapped file or as a converted copy.
+class point_loader {
+public:
+    // Map the whole file privately. Return false if it cannot be read.
+    static bool map(string const& path, point_cloud& cloud)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+            return false;
+        cloud.map_ = p;
+        cloud.map_size_ = st.st_size;
+        return true;
+    }
+    static char* bytes(point_cloud const& cloud)
+    {
+        return static_cast<char*>(cloud.map_);
+    }
+    static size_t num_bytes(point_cloud const& cloud)
+    {
+        return cloud.map_size_;
+    }
+    // View num packed points at offset of the mapped file.
+    static void view(point_cloud& cloud, size_t offset, size_t num)
+    {
+        cloud.points_ = span<xyz>(reinterpret_cast<xyz*>(bytes(cloud) + offset), num);
+    }
+    // Make room for num converted points, which the caller fills before calling unmap.
+    static span<xyz> allocate(point_cloud& cloud, size_t num)
+    {
+        cloud.owned_.resize(num);
+        cloud.points_ = span<xyz>(cloud.owned_.data(), num);
+        return cloud.points_;
+    }
+    // Drop the mapping once the points are converted.
+    static void unmap(point_cloud& cloud)
+    {
+        munmap(cloud.map_, cloud.map_size_);
+        cloud.map_ = nullptr;
+        cloud.map_size_ = 0;
+    }
+};
+
+// Run f(begin, end) over [0, num) in chunks of grain, on num_threads threads.
+template <typename F>
+static void parallel_chunks(size_t num, size_t grain, int num_threads, F f)
+{
+    tbb::task_arena arena(num_threads > 0 ? num_threads : int(tbb::task_arena::automatic));
+    arena.execute([&] {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num, grain), [&](tbb::blocked_range<size_t> const& r) {
+            f(r.begin(), r.end());
+        });
+    });
+}
+
+static bool little_endian()
+{
+    uint16_t one = 1;
+    return *reinterpret_cast<char*>(&one) == 1;
+}
+
+// *** BINARY ***
+
+enum scalar_type { INVALID, INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+static size_t scalar_size(scalar_type t)
+{
+    static size_t const sizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+    return sizes[t];
+}
+
+// Read a scalar from unaligned memory, swapping its bytes if swap.
+static REAL read_scalar(char const* p, scalar_type t, bool swap)
+{
+    char b[8];
+    size_t size = scalar_size(t);
+    memcpy(b, p, size);
+    if (swap)
+        reverse(b, b + size);
+    switch (t)
+    {
+    case INT8: { int8_t v; memcpy(&v, b, 1); return v; }
+    case UINT8: { uint8_t v; memcpy(&v, b, 1); return v; }
+    case INT16: { int16_t v; memcpy(&v, b, 2); return v; }
+    case UINT16: { uint16_t v; memcpy(&v, b, 2); return v; }
+    case INT32: { int32_t v; memcpy(&v, b, 4); return v; }
+    case UINT32: { uint32_t v; memcpy(&v, b, 4); return v; }
+    case FLOAT32: { float v; memcpy(&v, b, 4); return v; }
+    case FLOAT64: { double v; memcpy(&v, b, 8); return v; }
+    default: return 0;
+    }
+}
+
+// Layout of a binary record holding a point.
+struct record_layout {
+    size_t stride;
+    size_t offsets[3];
+    scalar_type types[3];
+    bool swap;
+
+    // True if the records are exactly packed native xyz.
+    bool packed_xyz() const
+    {
+        return stride == sizeof(xyz) && !swap &&
+               offsets[0] == 0 && offsets[1] == sizeof(REAL) && offsets[2] == 2 * sizeof(REAL) &&
+               types[0] == FLOAT64 && types[1] == FLOAT64 && types[2] == FLOAT64;
+    }
+};
+
+// Make cloud the num records at offset of its mapped file, viewed in place if they
+// are packed native xyz and aligned, converted in parallel otherwise.
+static bool load_records(point_cloud& cloud, size_t offset, size_t num, record_layout const& layout, int num_threads)
+{
+    char* data = point_loader::bytes(cloud) + offset;
+    if (offset + num * layout.stride > point_loader::num_bytes(cloud))
+        return false;
+    if (layout.packed_xyz() && reinterpret_cast<uintptr_t>(data) % alignof(xyz) == 0)
+    {
+        point_loader::view(cloud, offset, num);
+        return true;
+    }
+    span<xyz> points = point_loader::allocate(cloud, num);
+    parallel_chunks(num, POINT_CHUNK, num_threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            char const* record = data + i * layout.stride;
+            for (int k = 0; k < 3; ++k)
+                points[i][k] = read_scalar(record + layout.offsets[k], layout.types[k], layout.swap);
+        }
+    });
+    point_loader::unmap(cloud);
+    return true;
+}
+
+bool load_xyz_binary(string const& path, bool single_precision, point_cloud& cloud, int num_threads)
+{
+    point_cloud ret;
+    if (!point_loader::map(path, ret))
+        return false;
+    scalar_type type = single_precision ? FLOAT32 : FLOAT64;
+    size_t size = scalar_size(type);
+    record_layout layout = {3 * size, {0, size, 2 * size}, {type, type, type}, false};
+    if (point_loader::num_bytes(ret) % layout.stride != 0 ||
+        !load_records(ret, 0, point_loader::num_bytes(ret) / layout.stride, layout, num_threads))
+        return false;
+    cloud = move(ret);
+    return true;
+}
+
+// *** TEXT ***
+
+// Parse the numbers in columns[0], columns[1], columns[2] of a line into x, y, z.
+// Return false if the line is too short.
+static bool parse_line(char const* begin, char const* end, int const* columns, xyz& p)
+{
+    // strtod needs a terminated string, the mapped text is not
+    char buffer[256];
+    string long_line;
+    char const* s = buffer;
+    if (end - begin < ptrdiff_t(sizeof(buffer)))
+    {
+        memcpy(buffer, begin, end - begin);
+        buffer[end - begin] = 0;
+    }
+    else
+    {
+        long_line.assign(begin, end);
+        s = long_line.c_str();
+    }
+    int column = 0;
+    int found = 0;
+    while (found < 3)
+    {
+        while (*s == ' ' || *s == '\t' || *s == '\r' || *s == ',')
+            ++s;
+        if (!*s)
+            return false;
+        char* next;
+        REAL v = strtod(s, &next);
+        if (next == s)
+            return false;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (columns[k] == column)
+            {
+                p[k] = v;
+                ++found;
+            }
+        }
+        s = next;
+        ++column;
+    }
+    return true;
+}
+
+static bool data_line(char const* begin, char const* end)
+{
+    while (begin != end && (*begin == ' ' || *begin == '\t' || *begin == '\r'))
+        ++begin;
+    return begin != end && *begin != '#';
+}
+
+static bool any_line(char const*, char const*)
+{
+    return true;
+}
+
+// Parse the lines of [begin, end) accepted by accept, skipping the first `first` of
+// them and keeping at most num (all if num is -1). Chunks of text are parsed in
+// parallel: a first pass counts the lines of each chunk, a prefix sum gives the index
+// of the first line of each chunk, and a second pass parses lines into place.
+template <typename Accept>
+static bool parse_lines(char const* begin, char const* end, size_t first, size_t num, int const* columns,
+        Accept accept, int num_threads, point_cloud& cloud)
+{
+    // chunk c covers the lines starting in [starts[c], starts[c + 1])
+    size_t num_chunks = (end - begin + TEXT_CHUNK - 1) / TEXT_CHUNK;
+    vector<char const*> starts(num_chunks + 1, end);
+    starts[0] = begin;
+    for (size_t c = 1; c < num_chunks; ++c)
+    {
+        char const* p = static_cast<char const*>(memchr(begin + c * TEXT_CHUNK - 1, '\n', end - (begin + c * TEXT_CHUNK - 1)));
+        starts[c] = p ? p + 1 : end;
+    }
+    auto for_lines = [&](size_t c, function<void (char const*, char const*)> f) {
+        char const* line = starts[c];
+        while (line < starts[c + 1])
+        {
+            char const* eol = static_cast<char const*>(memchr(line, '\n', end - line));
+            if (!eol)
+                eol = end;
+            if (accept(line, eol))
+                f(line, eol);
+            line = eol + 1;
+        }
+    };
+
+    vector<size_t> counts(num_chunks + 1, 0);
+    parallel_chunks(num_chunks, 1, num_threads, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c)
+            for_lines(c, [&](char const*, char const*) { ++counts[c + 1]; });
+    });
+    partial_sum(counts.begin(), counts.end(), counts.begin());
+    if (counts[num_chunks] < first)
+        return false;
+    if (num == size_t(-1))
+        num = counts[num_chunks] - first;
+    if (counts[num_chunks] - first < num)
+        return false;
+
+    span<xyz> points = point_loader::allocate(cloud, num);
+    bool ok = true;
+    parallel_chunks(num_chunks, 1, num_threads, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c)
+        {
+            size_t index = counts[c];
+            for_lines(c, [&](char const* line, char const* eol) {
+                if (index >= first && index < first + num && !parse_line(line, eol, columns, points[index - first]))
+                    ok = false;
+                ++index;
+            });
+        }
+    });
+    point_loader::unmap(cloud);
+    return ok;
+}
+
+bool load_xyz_ascii(string const& path, point_cloud& cloud, int num_threads)
+{
+    point_cloud ret;
+    if (!point_loader::map(path, ret))
+        return false;
+    char const* begin = point_loader::bytes(ret);
+    int const columns[3] = {0, 1, 2};
+    if (!parse_lines(begin, begin + point_loader::num_bytes(ret), 0, size_t(-1), columns, data_line, num_threads, ret))
+        return false;
+    cloud = move(ret);
+    return true;
+}
+
+// *** PLY ***
+
+static scalar_type ply_type(string const& name)
+{
+    if (name == "char" || name == "int8") return INT8;
+    if (name == "uchar" || name == "uint8") return UINT8;
+    if (name == "short" || name == "int16") return INT16;
+    if (name == "ushort" || name == "uint16") return UINT16;
+    if (name == "int" || name == "int32") return INT32;
+    if (name == "uint" || name == "uint32") return UINT32;
+    if (name == "float" || name == "float32") return FLOAT32;
+    if (name == "double" || name == "float64") return FLOAT64;
+    return INVALID;
+}
+
+struct ply_element {
+    string name;
+    size_t count;
+    // fixed size properties only, a list property makes the size unknown
+    vector<pair<string, scalar_type> > properties;
+    bool has_list;
+};
+
+bool load_ply(string const& path, point_cloud& cloud, int num_threads)
+{
+    point_cloud ret;
+    if (!point_loader::map(path, ret))
+        return false;
+    char const* begin = point_loader::bytes(ret);
+    char const* end = begin + point_loader::num_bytes(ret);
+
+    // header
+    static char const END_HEADER[] = "end_header";
+    char const* header_end = search(begin, end, END_HEADER, END_HEADER + sizeof(END_HEADER) - 1);
+    if (header_end == end)
+        return false;
+    char const* body = static_cast<char const*>(memchr(header_end, '\n', end - header_end));
+    if (!body)
+        return false;
+    ++body;
+    istringstream header(string(begin, header_end));
+    string line, format;
+    vector<ply_element> elements;
+    if (!getline(header, line) || line.compare(0, 3, "ply") != 0)
+        return false;
+    while (getline(header, line))
+    {
+        istringstream words(line);
+        string word;
+        words >> word;
+        if (word == "format")
+        {
+            words >> format;
+        }
+        else if (word == "element")
+        {
+            ply_element element;
+            words >> element.name >> element.count;
+            element.has_list = false;
+            elements.push_back(element);
+        }
+        else if (word == "property" && !elements.empty())
+        {
+            string type, name;
+            words >> type;
+            if (type == "list")
+            {
+                elements.back().has_list = true;
+                continue;
+            }
+            words >> name;
+            elements.back().properties.push_back(make_pair(name, ply_type(type)));
+        }
+    }
+
+    // locate the vertex element and its x, y, z
+    size_t vertex = 0;
+    while (vertex < elements.size() && elements[vertex].name != "vertex")
+        ++vertex;
+    if (vertex == elements.size() || elements[vertex].has_list)
+        return false;
+    auto&& properties = elements[vertex].properties;
+    int columns[3] = {-1, -1, -1};
+    record_layout layout = {0, {0, 0, 0}, {INVALID, INVALID, INVALID}, false};
+    char const* names[3] = {"x", "y", "z"};
+    for (size_t i = 0; i < properties.size(); ++i)
+    {
+        if (properties[i].second == INVALID)
+            return false;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (properties[i].first == names[k])
+            {
+                columns[k] = i;
+                layout.offsets[k] = layout.stride;
+                layout.types[k] = properties[i].second;
+            }
+        }
+        layout.stride += scalar_size(properties[i].second);
+    }
+    if (columns[0] == -1 || columns[1] == -1 || columns[2] == -1)
+        return false;
+
+    bool ok;
+    if (format == "ascii")
+    {
+        size_t first = 0;
+        for (size_t e = 0; e < vertex; ++e)
+            first += elements[e].count;
+        ok = parse_lines(body, end, first, elements[vertex].count, columns, any_line, num_threads, ret);
+    }
+    else if (format == "binary_little_endian" || format == "binary_big_endian")
+    {
+        layout.swap = (format == "binary_little_endian") != little_endian();
+        size_t offset = body - begin;
+        for (size_t e = 0; e < vertex; ++e)
+        {
+            if (elements[e].has_list)
+                return false;
+            size_t size = 0;
+            for (auto&& p : elements[e].properties)
+                size += scalar_size(p.second);
+            offset += size * elements[e].count;
+        }
+        ok = load_records(ret, offset, elements[vertex].count, layout, num_threads);
+    }
+    else
+    {
+        return false;
+    }
+    if (!ok)
+        return false;
+    cloud = move(ret);
+    return true;
+}
+
+bool load_points(string const& path, point_cloud& cloud, int num_threads)
+{
+    auto ends_with = [&](char const* ext) {
+        size_t n = strlen(ext);
+        return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (ends_with(".ply"))
+        return load_ply(path, cloud, num_threads);
+    if (ends_with(".f32"))
+        return load_xyz_binary(path, true, cloud, num_threads);
+    if (ends_with(".bin") || ends_with(".f64"))
+        return load_xyz_binary(path, false, cloud, num_threads);
+    return load_xyz_ascii(path, cloud, num_threads);
+}
@@ -0,0 +1,48 @@
+#ifndef POINT_IO_H
+
+#define POINT_IO_H
+
+#include <string>
+#include <vector>
+#include "types.h"
+
+// Points loaded from a file: a view of the mapped file when its layout is already
+// packed native doubles, a converted copy otherwise. The mapping is private, so the
+// points can be reordered in place (e.g. by spatial_sort) without touching the file.
+class point_cloud {
+public:
+	point_cloud();
+	point_cloud(point_cloud&& other);
+	point_cloud& operator=(point_cloud&& other);
+	~point_cloud();
+	point_cloud(point_cloud const&) = delete;
+	point_cloud& operator=(point_cloud const&) = delete;
+
+	span<xyz> points() const { return points_; }
+	size_t size() const { return points_.size(); }
+	// True if points() views the mapped file, false if it views a copy.
+	bool mapped() const { return map_ != nullptr && owned_.empty(); }
+
+private:
+	friend class point_loader;
+	void reset();
+
+	// the mapped file, kept while points_ views it
+	void* map_;
+	size_t map_size_;
+	std::vector<xyz> owned_;
+	span<xyz> points_;
+};
+
+// Raw binary file of packed x, y, z triples, double or float.
+bool load_xyz_binary(std::string const& path, bool single_precision, point_cloud& cloud, int num_threads = 0);
+// PLY file, ascii or binary, reading the x, y, z properties of its vertex element.
+bool load_ply(std::string const& path, point_cloud& cloud, int num_threads = 0);
+// ASCII file with one point per line, the first 3 numbers of a line are x, y, z.
+// Blank lines and lines starting with # are skipped.
+bool load_xyz_ascii(std::string const& path, point_cloud& cloud, int num_threads = 0);
+// Pick the loader by extension: .ply, .f32 (float binary), .bin/.f64 (double binary),
+// anything else as ASCII.
+bool load_points(std::string const& path, point_cloud& cloud, int num_threads = 0);
+
+#endif /* end of include guard: POINT_IO_H */
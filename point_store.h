@@ -0,0 +1,189 @@
+#pragma once
+
+#include "types.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Positions, weights, locks and conflict list links of the points of a triangulation, in pages of PAGE_SIZE
+// points. A page either views points owned by the caller or owns points appended later,
+// so points can be added between runs, and pages no tetra needs anymore can be released.
+// Weights are optional, a page without them weighs its points 0.
+// Pages are only added or released while no task runs.
+// Coordinates are T, double or float.
+template <typename T>
+class basic_point_store {
+public:
+	typedef std::array<T, 3> point_type;
+
+	static int const PAGE_BITS = 16;
+	static point_k const PAGE_SIZE = 1 << PAGE_BITS;
+
+	// Each point has a lock, only ever tried and never waited for, so one byte does
+	// where a std::mutex takes 40.
+	class point_mutex {
+	public:
+		point_mutex() : locked_(false) {}
+		bool try_lock() {
+			return !locked_.exchange(true, std::memory_order_acquire);
+		}
+		void unlock() {
+			locked_.store(false, std::memory_order_release);
+		}
+	private:
+		std::atomic<bool> locked_;
+	};
+
+	basic_point_store() : size_(0) {}
+
+	// View the caller's points and their weights if any, which must outlive the store.
+	// The store must be empty.
+	void assign(span<point_type const> xyzs, span<REAL const> weights = span<REAL const>()) {
+		size_ = xyzs.size();
+		pages_.resize((size_ + PAGE_SIZE - 1) / PAGE_SIZE);
+		for (size_t i = 0; i < pages_.size(); ++i) {
+			pages_[i].pos = xyzs.data() + i * PAGE_SIZE;
+			if (!weights.empty()) pages_[i].weights = weights.data() + i * PAGE_SIZE;
+			add_links(pages_[i]);
+		}
+	}
+
+	// Copy points, and their weights if any, after the existing ones. Return the key
+	// of the first one.
+	point_k append(span<point_type const> xyzs, span<REAL const> weights = span<REAL const>()) {
+		point_k first = size_;
+		size_t offset = size_ % PAGE_SIZE;
+		// the last page views the caller's points, own it to extend it
+		if (offset != 0) own(pages_.back(), offset, !weights.empty());
+		for (size_t i = 0; i < xyzs.size(); ++i) {
+			if (size_ % PAGE_SIZE == 0) {
+				pages_.push_back(page());
+				pages_.back().owned.reset(new point_type[PAGE_SIZE]);
+				pages_.back().pos = pages_.back().owned.get();
+				add_links(pages_.back());
+				if (!weights.empty()) own(pages_.back(), 0, true);
+			}
+			page& pg = pages_.back();
+			pg.owned[size_ % PAGE_SIZE] = xyzs[i];
+			if (pg.weights) pg.owned_weights[size_ % PAGE_SIZE] = weights.empty() ? 0 : weights[i];
+			++size_;
+		}
+		return first;
+	}
+
+	size_t size() const {
+		return size_;
+	}
+	size_t num_pages() const {
+		return pages_.size();
+	}
+
+	// Move point k, copying its page first if it views the caller's points.
+	void set(point_k k, point_type const& p) {
+		page& pg = pages_[k >> PAGE_BITS];
+		own(pg, std::min<size_t>(PAGE_SIZE, size_ - (size_t(k) & ~size_t(PAGE_SIZE - 1))), false);
+		pg.owned[k & (PAGE_SIZE - 1)] = p;
+	}
+
+	// Copy the pages viewing the caller's points, so that set() can run on several
+	// threads at once, each on its own points.
+	void own_pages() {
+		for (size_t i = 0; i < pages_.size(); ++i) {
+			if (pages_[i].pos) own(pages_[i], std::min<size_t>(PAGE_SIZE, size_ - i * PAGE_SIZE), false);
+		}
+	}
+
+	point_type const& operator[](point_k k) const {
+		return pages_[k >> PAGE_BITS].pos[k & (PAGE_SIZE - 1)];
+	}
+	// The predicates of predicates.c take non-const pointers but do not write through them.
+	T* pos(point_k k) const {
+		return const_cast<T*>((*this)[k].data());
+	}
+	REAL weight(point_k k) const {
+		page const& pg = pages_[k >> PAGE_BITS];
+		return pg.weights ? pg.weights[k & (PAGE_SIZE - 1)] : 0;
+	}
+	point_mutex& lock(point_k k) const {
+		return pages_[k >> PAGE_BITS].locks[k & (PAGE_SIZE - 1)];
+	}
+	// The point after k in the conflict list holding k, see simplex_pool::first_point().
+	point_k& next(point_k k) const {
+		return pages_[k >> PAGE_BITS].next[k & (PAGE_SIZE - 1)];
+	}
+
+	// Drop the points, keeping the locks and links of their pages for the next ones, so
+	// that a store refilled again and again allocates them once. No lock may be held.
+	void clear() {
+		for (auto&& pg : pages_) {
+			if (!pg.locks) continue;
+			spare_.push_back(page());
+			spare_.back().locks = std::move(pg.locks);
+			spare_.back().next = std::move(pg.next);
+		}
+		pages_.clear();
+		size_ = 0;
+	}
+
+	bool released(size_t page) const {
+		return !pages_[page].pos;
+	}
+	// Free the positions, locks and links of a page. Its points must not be used anymore.
+	void release(size_t page) {
+		pages_[page].pos = nullptr;
+		pages_[page].owned.reset();
+		pages_[page].weights = nullptr;
+		pages_[page].owned_weights.reset();
+		pages_[page].locks.reset();
+		pages_[page].next.reset();
+	}
+
+private:
+	struct page {
+		point_type const* pos;
+		std::unique_ptr<point_type[]> owned;
+		// null if the points of the page weigh 0
+		REAL const* weights;
+		std::unique_ptr<REAL[]> owned_weights;
+		std::unique_ptr<point_mutex[]> locks;
+		std::unique_ptr<point_k[]> next;
+		page() : pos(nullptr), weights(nullptr) {}
+	};
+
+	// Give a new page locks and links, those of a page dropped by clear() if any.
+	void add_links(page& pg) {
+		if (spare_.empty()) {
+			pg.locks.reset(new point_mutex[PAGE_SIZE]);
+			pg.next.reset(new point_k[PAGE_SIZE]);
+			return;
+		}
+		pg.locks = std::move(spare_.back().locks);
+		pg.next = std::move(spare_.back().next);
+		spare_.pop_back();
+	}
+
+	// Copy the first num points of a page viewing the caller's points into the page,
+	// and their weights if the page has some or with_weights, 0 if it had none.
+	static void own(page& pg, size_t num, bool with_weights) {
+		if (!pg.owned) {
+			pg.owned.reset(new point_type[PAGE_SIZE]);
+			std::copy(pg.pos, pg.pos + num, pg.owned.get());
+			pg.pos = pg.owned.get();
+		}
+		if ((with_weights || pg.weights) && !pg.owned_weights) {
+			pg.owned_weights.reset(new REAL[PAGE_SIZE]());
+			if (pg.weights) std::copy(pg.weights, pg.weights + num, pg.owned_weights.get());
+			pg.weights = pg.owned_weights.get();
+		}
+	}
+
+	std::vector<page> pages_;
+	// locks and links of the pages dropped by clear()
+	std::vector<page> spare_;
+	size_t size_;
+};
+
+typedef basic_point_store<REAL> point_store;
@@ -9,6 +9,18 @@
 extern "C" {
 	extern void exactinit();
 
+	/*Return a positive value if the points pa, pb, and pc occur  */
+	/*in counterclockwise order; a negative value if they occur   */
+	/*in clockwise order; and zero if they are collinear.         */
+	extern REAL orient2d(REAL *pa, REAL *pb, REAL *pc);
+
+	/*Return a positive value if the point pd lies inside the     */
+	/*circle passing through pa, pb, and pc; a negative value if  */
+	/*it lies outside; and zero if the four points are cocircular.*/
+	/*The points pa, pb, and pc must be in counterclockwise       */
+	/*order, or the sign of the result will be reversed.          */
+	extern REAL incircle(REAL *pa, REAL *pb, REAL *pc, REAL *pd);
+
 	/*Return a positive value if the point pd lies below the plane */
 	/*passing through pa, pb, and pc; "below" is defined so */
 	/*that pa, pb, and pc appear in counterclockwise order when   */
@@ -25,6 +37,26 @@ extern "C" {
 	/*orient3d()), or the sign of the result will be reversed.    */
 	extern REAL inspherefast(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe);
 	extern REAL insphere(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe);
+
+	/*The insphere test of weighted points, whose lifted coordinate is   */
+	/*x^2 + y^2 + z^2 - weight: positive if pe is in conflict with the   */
+	/*sphere orthogonal to pa, pb, pc and pd (the power of its center to */
+	/*pe is less than the weight of pe), negative if not, zero if the    */
+	/*five share an orthogonal sphere. insphere() if the weights are 0.  */
+	/*Counted as insphere() calls.                                       */
+	extern REAL powertestfast(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe,
+		REAL aweight, REAL bweight, REAL cweight, REAL dweight, REAL eweight);
+	extern REAL powertest(REAL *pa, REAL *pb, REAL *pc, REAL *pd, REAL *pe,
+		REAL aweight, REAL bweight, REAL cweight, REAL dweight, REAL eweight);
+
+#ifdef TRIANGULATOR_STATS
+	/* Per thread calls of orient3d() and insphere(), and the calls that needed */
+	/* the exact stage because the floating point filter failed.                */
+	extern __thread unsigned long long predicate_orient3d_calls;
+	extern __thread unsigned long long predicate_orient3d_filter_failures;
+	extern __thread unsigned long long predicate_insphere_calls;
+	extern __thread unsigned long long predicate_insphere_filter_failures;
+#endif
 }
 
 
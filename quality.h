@@ -0,0 +1,110 @@
+#pragma once
+
+#include "types.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <ostream>
+
+// The cosines of the 6 dihedral angles of the tetra abcd, at its edges ab, ac, ad, bc,
+// bd and cd. A flat tetra has angles of 0 and 180 degrees.
+inline void dihedral_cosines(xyz const& a, xyz const& b, xyz const& c, xyz const& d, REAL cosines[6]) {
+	xyz const* p[4] = {&a, &b, &c, &d};
+	// normal of the face opposite each point, pointing away from it
+	xyz n[4];
+	for (int i = 0; i < 4; ++i) {
+		xyz const& o = *p[(i + 1) % 4];
+		xyz const& q = *p[(i + 2) % 4];
+		xyz const& r = *p[(i + 3) % 4];
+		xyz u = {q[0] - o[0], q[1] - o[1], q[2] - o[2]};
+		xyz v = {r[0] - o[0], r[1] - o[1], r[2] - o[2]};
+		n[i] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+		xyz const& s = *p[i];
+		if (n[i][0] * (s[0] - o[0]) + n[i][1] * (s[1] - o[1]) + n[i][2] * (s[2] - o[2]) > 0) {
+			for (auto&& x : n[i]) x = -x;
+		}
+	}
+	// the angle at edge ij is between the faces opposite its other points k and l
+	static int const others[6][2] = {{2, 3}, {1, 3}, {1, 2}, {0, 3}, {0, 2}, {0, 1}};
+	for (int e = 0; e < 6; ++e) {
+		xyz const& u = n[others[e][0]];
+		xyz const& v = n[others[e][1]];
+		REAL len = std::sqrt((u[0] * u[0] + u[1] * u[1] + u[2] * u[2]) * (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]));
+		REAL cosine = len > 0 ? -(u[0] * v[0] + u[1] * v[1] + u[2] * v[2]) / len : 1;
+		cosines[e] = std::max<REAL>(-1, std::min<REAL>(1, cosine));
+	}
+}
+
+// The 6 dihedral angles of the tetra abcd in degrees, in the order of dihedral_cosines().
+inline void dihedral_angles(xyz const& a, xyz const& b, xyz const& c, xyz const& d, REAL angles[6]) {
+	dihedral_cosines(a, b, c, d, angles);
+	for (int e = 0; e < 6; ++e) angles[e] = std::acos(angles[e]) * 180 / M_PI;
+}
+
+inline REAL min_dihedral_angle(xyz const& a, xyz const& b, xyz const& c, xyz const& d) {
+	REAL cosines[6];
+	dihedral_cosines(a, b, c, d, cosines);
+	return std::acos(*std::max_element(cosines, cosines + 6)) * 180 / M_PI;
+}
+
+// Distribution of the dihedral angles of tetras, in bins of 10 degrees.
+struct dihedral_stats {
+	static int const BINS = 18;
+
+	size_t num_tetras;
+	// tetras with an angle below sliver_angle
+	size_t num_slivers;
+	REAL sliver_angle;
+	REAL min_angle;
+	REAL max_angle;
+	size_t bins[BINS];
+
+	explicit dihedral_stats(REAL sliver = 5) :
+		num_tetras(0), num_slivers(0), sliver_angle(sliver),
+		min_angle(std::numeric_limits<REAL>::infinity()), max_angle(0)
+	{
+		std::memset(bins, 0, sizeof(bins));
+	}
+
+	void add(xyz const& a, xyz const& b, xyz const& c, xyz const& d) {
+		REAL angles[6];
+		dihedral_angles(a, b, c, d, angles);
+		REAL lo = *std::min_element(angles, angles + 6);
+		++num_tetras;
+		if (lo < sliver_angle) ++num_slivers;
+		min_angle = std::min(min_angle, lo);
+		max_angle = std::max(max_angle, *std::max_element(angles, angles + 6));
+		for (auto&& x : angles) ++bins[std::min(BINS - 1, int(x / 10))];
+	}
+
+	dihedral_stats& operator+=(dihedral_stats const& other) {
+		num_tetras += other.num_tetras;
+		num_slivers += other.num_slivers;
+		min_angle = std::min(min_angle, other.min_angle);
+		max_angle = std::max(max_angle, other.max_angle);
+		for (int i = 0; i < BINS; ++i) bins[i] += other.bins[i];
+		return *this;
+	}
+
+	void write_text(std::ostream& os) const {
+		os << "tetras: " << num_tetras << ", slivers (below " << sliver_angle << " degrees): " << num_slivers << "\n"
+		   << "dihedral angles: min " << (num_tetras ? min_angle : 0) << ", max " << max_angle << "\n"
+		   << "histogram:";
+		for (int i = 0; i < BINS; ++i) os << ' ' << 10 * i << ':' << bins[i];
+		os << "\n";
+	}
+};
+
+// Dihedral angles of a triangulation before and after removing slivers.
+struct sliver_report {
+	dihedral_stats before;
+	dihedral_stats after;
+	// vertices moved and rounds run
+	size_t moves;
+	int rounds;
+
+	sliver_report() : moves(0), rounds(0) {}
+};
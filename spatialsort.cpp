@@ -8,15 +8,26 @@
 #include <cassert>
 #include <omp.h>
 #include "types.h"
+#include "spatialsort.h"
 using namespace std; 
 
 
+// A point with its index in the input, to sort points for their order only.
+struct indexed_xyz
+{
+    xyz p;
+    size_t index;
+};
+
+inline xyz const& position(xyz const& p) { return p; }
+inline xyz const& position(indexed_xyz const& p) { return p.p; }
 
 // find which of the x,y,z axes has the greatest 
 // diameter, find its median and partition the points. 
 // axe is [0,1,2] representing [x,y.z]
+template <typename T>
 inline void find_greatest_diameter(
-    vector<xyz> &xyzs, int pos, int size, int &axe, REAL &median)
+    T *xyzs, int pos, int size, int &axe, REAL &median)
 {
     //cout << "find_greatest_diameter(){";
     //Output(xyzs, pos, size);
@@ -26,7 +37,7 @@ inline void find_greatest_diameter(
     //for (auto&& p : xyzs)
     for (int i = pos; i < pos + size; i++)
     {
-        xyz p = xyzs[i];
+        xyz const& p = position(xyzs[i]);
 
         if (to_init >>=1)
         {
@@ -60,21 +71,22 @@ inline void find_greatest_diameter(
 }
 
 // return the num_points on the left size
+template <typename T>
 inline int reorder_points(
-    vector<xyz> &xyzs, int pos, int size, int axe, REAL median)
+    T *xyzs, int pos, int size, int axe, REAL median)
 {
     //cout << "reorder_points(){";
     //Output(xyzs, pos, size);
 
-    vector<xyz> left;
-    vector<xyz> right;
+    vector<T> left;
+    vector<T> right;
 
     //for (auto&& p: xyzs)
     for (int i = pos; i < pos+size; i++)
     {
-        xyz p = xyzs[i];
+        T p = xyzs[i];
 
-        if (p[axe] <= median)
+        if (position(p)[axe] <= median)
         {
             left.push_back(p);
         }
@@ -98,21 +110,22 @@ inline int reorder_points(
 }
 
 // return the num_points on the left size
+template <typename T>
 inline int reorder_points_inplace(
-    vector<xyz> &xyzs, int pos, int size, int axe, REAL median)
+    T *xyzs, int pos, int size, int axe, REAL median)
 {
     int l = pos;
     int r = pos + size - 1;
     while (l <= r)
     {
-        if (xyzs[l][axe] > median && 
-            xyzs[r][axe] <= median)
+        if (position(xyzs[l])[axe] > median && 
+            position(xyzs[r])[axe] <= median)
         {
             swap(xyzs[l], xyzs[r]);
         }
-        if (xyzs[l][axe] <= median)
+        if (position(xyzs[l])[axe] <= median)
             l++;
-        if (xyzs[r][axe] > median)
+        if (position(xyzs[r])[axe] > median)
             r--;
     }
     //cout << "median=" << median << endl;
@@ -120,10 +133,11 @@ inline int reorder_points_inplace(
     return l - pos;
 }
 
-inline void spatial_sort_kernel(vector<xyz> &xyzs, int pos, int size)
+template <typename T>
+inline void spatial_sort_kernel(T *xyzs, int pos, int size)
 {
     //cout << "thread_num=" << omp_get_thread_num() << endl;
-    assert(pos >= 0 && pos + size <= xyzs.size());
+    assert(pos >= 0 && size >= 0);
     if (size < 2)
         return;
 
@@ -137,6 +151,9 @@ inline void spatial_sort_kernel(vector<xyz> &xyzs, int pos, int size)
 #else
     int left_size = reorder_points(xyzs, pos, size, axe, median);
 #endif
+    // all the points are at the same position
+    if (left_size == 0 || left_size == size)
+        return;
 
 #pragma omp task shared(xyzs)
     spatial_sort_kernel(xyzs, pos, left_size);
@@ -145,6 +162,11 @@ inline void spatial_sort_kernel(vector<xyz> &xyzs, int pos, int size)
 }
 
 void spatial_sort(std::vector<xyz> &xyzs)
+{
+    spatial_sort(span<xyz>(xyzs.data(), xyzs.size()));
+}
+
+void spatial_sort(span<xyz> xyzs)
 {
 #ifndef PARALLEL
     omp_set_num_threads(1);
@@ -154,8 +176,26 @@ void spatial_sort(std::vector<xyz> &xyzs)
     {
         //cout << "run_spatial_sort_with_num_threads=" << omp_get_num_threads() << endl;
         #pragma omp single
-        spatial_sort_kernel(xyzs, 0, xyzs.size());
+        spatial_sort_kernel(xyzs.data(), 0, xyzs.size());
+    }
+}
+
+vector<size_t> spatial_sort_order(span<xyz const> xyzs)
+{
+    vector<indexed_xyz> sorted(xyzs.size());
+    for (size_t i = 0; i < xyzs.size(); ++i)
+        sorted[i] = {xyzs[i], i};
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        spatial_sort_kernel(sorted.data(), 0, sorted.size());
     }
+
+    vector<size_t> order(sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i)
+        order[i] = sorted[i].index;
+    return order;
 }
 
 void spatial_sort(vector<xyz> &xyzs, int num_threads)
@@ -166,7 +206,7 @@ void spatial_sort(vector<xyz> &xyzs, int num_threads)
     {
         //cout << "run_spatial_sort_with_num_threads=" << omp_get_num_threads() << endl;
         #pragma omp single
-        spatial_sort_kernel(xyzs, 0, xyzs.size());
+        spatial_sort_kernel(xyzs.data(), 0, xyzs.size());
     }
 }
 
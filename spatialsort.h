@@ -6,7 +6,12 @@
 #include "types.h"
 
 void spatial_sort(std::vector<xyz> &xyzs);
+// Sort points viewed in place, e.g. a mapped point cloud.
+void spatial_sort(span<xyz> xyzs);
 void spatial_sort(std::vector<xyz> &xyzs, int num_threads);
+// The indices of the points in the order spatial_sort would put them, leaving the
+// points where they are.
+std::vector<size_t> spatial_sort_order(span<xyz const> xyzs);
 
 
 #endif /* end of include guard: SPATIALSORT_H */
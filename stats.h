@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#	include <x86intrin.h>
+#else
+#	include <chrono>
+#endif
+
+// Hot path instrumentation, compiled in with -DTRIANGULATOR_STATS (make STATS=1).
+// STATS(statement) only runs the statement then, so it costs nothing otherwise.
+#ifdef TRIANGULATOR_STATS
+#	define STATS(statement) statement
+#else
+#	define STATS(statement)
+#endif
+
+// Clock of the timers: the time stamp counter, or nanoseconds where there is none.
+inline uint64_t stats_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Counters and timers of the triangulation tasks. Each worker counts in its own
+// copy, and the copies are summed when the job queue has run.
+struct triangulation_stats {
+	// Bin i counts the cavities of 2^i to 2^(i+1) - 1 tetras, the last bin the larger ones.
+	static int const CAVITY_BINS = 10;
+
+	uint64_t tasks;
+	// tasks whose tetra was replaced before they ran
+	uint64_t stale_tasks;
+	// tasks put back in the queue after failing to lock a point
+	uint64_t retries;
+	uint64_t insertions;
+	// points dropped on an existing vertex
+	uint64_t duplicates;
+	// weighted points dropped as hidden by the others
+	uint64_t hidden;
+	// circumcenters of refine() dropped since their bad tetra was already replaced
+	uint64_t obsolete;
+	uint64_t lock_attempts;
+	uint64_t lock_failures;
+	uint64_t cavity_hist[CAVITY_BINS];
+	uint64_t cavity_tetras;
+	uint64_t new_tetras;
+	// points of a cavity handed to the new tetras
+	uint64_t redistributed;
+	// in_conflict() and in_region() tests, the latter in place of intetra()
+	uint64_t conflict_tests;
+	uint64_t region_tests;
+	// calls of the exact predicates, and the calls whose floating point filter failed
+	uint64_t orient3d_calls;
+	uint64_t orient3d_filter_failures;
+	uint64_t insphere_calls;
+	uint64_t insphere_filter_failures;
+	// edges sorted to glue the new tetras to each other, in place of face hashing
+	uint64_t link_edges;
+	// stats_clock() ticks in whole tasks, in their phases, and waiting for the queue
+	uint64_t task_cycles;
+	uint64_t cavity_cycles;
+	uint64_t build_cycles;
+	uint64_t redistribute_cycles;
+	uint64_t queue_wait_cycles;
+
+	triangulation_stats() {
+		clear();
+	}
+
+	void clear() {
+		std::memset(this, 0, sizeof(*this));
+	}
+
+	// The struct is nothing but counters, add them as an array.
+	triangulation_stats& operator+=(triangulation_stats const& other) {
+		uint64_t* a = reinterpret_cast<uint64_t*>(this);
+		uint64_t const* b = reinterpret_cast<uint64_t const*>(&other);
+		for (size_t i = 0; i < sizeof(*this) / sizeof(uint64_t); ++i) a[i] += b[i];
+		return *this;
+	}
+
+	void add_cavity(size_t size) {
+		int bin = 0;
+		while (bin + 1 < CAVITY_BINS && size >> (bin + 1)) ++bin;
+		++cavity_hist[bin];
+		cavity_tetras += size;
+	}
+
+	void write_text(std::ostream& os) const {
+		os << "tasks: " << tasks << " (stale " << stale_tasks << ", retried " << retries << ")\n"
+		   << "insertions: " << insertions << " (duplicates " << duplicates << ", hidden " << hidden << ", obsolete " << obsolete << ")\n"
+		   << "locks: " << lock_attempts << " attempts, " << lock_failures << " failures ("
+		   << rate(lock_failures, lock_attempts) << ")\n"
+		   << "cavity tetras: " << cavity_tetras << " (" << ratio(cavity_tetras, insertions) << " per insertion)\n"
+		   << "cavity sizes:";
+		for (int i = 0; i < CAVITY_BINS; ++i) os << ' ' << (size_t(1) << i) << (i + 1 < CAVITY_BINS ? ":" : "+:") << cavity_hist[i];
+		os << "\n"
+		   << "new tetras: " << new_tetras << "\n"
+		   << "redistributed points: " << redistributed << " (" << ratio(redistributed, insertions) << " per insertion)\n"
+		   << "conflict tests: " << conflict_tests << ", region tests: " << region_tests << "\n"
+		   << "orient3d: " << orient3d_calls << " calls, filter failures " << rate(orient3d_filter_failures, orient3d_calls) << "\n"
+		   << "insphere: " << insphere_calls << " calls, filter failures " << rate(insphere_filter_failures, insphere_calls) << "\n"
+		   << "link edges: " << link_edges << "\n"
+		   << "cycles: task " << task_cycles << ", cavity " << cavity_cycles << ", build " << build_cycles
+		   << ", redistribute " << redistribute_cycles << ", queue wait " << queue_wait_cycles << "\n";
+	}
+
+	void write_json(std::ostream& os) const {
+		os << "{\"tasks\": " << tasks << ", \"stale_tasks\": " << stale_tasks << ", \"retries\": " << retries
+		   << ", \"insertions\": " << insertions << ", \"duplicates\": " << duplicates << ", \"hidden\": " << hidden << ", \"obsolete\": " << obsolete
+		   << ", \"lock_attempts\": " << lock_attempts << ", \"lock_failures\": " << lock_failures
+		   << ", \"cavity_hist\": [";
+		for (int i = 0; i < CAVITY_BINS; ++i) os << (i ? ", " : "") << cavity_hist[i];
+		os << "], \"cavity_tetras\": " << cavity_tetras << ", \"new_tetras\": " << new_tetras
+		   << ", \"redistributed\": " << redistributed
+		   << ", \"conflict_tests\": " << conflict_tests << ", \"region_tests\": " << region_tests
+		   << ", \"orient3d_calls\": " << orient3d_calls << ", \"orient3d_filter_failures\": " << orient3d_filter_failures
+		   << ", \"insphere_calls\": " << insphere_calls << ", \"insphere_filter_failures\": " << insphere_filter_failures
+		   << ", \"link_edges\": " << link_edges
+		   << ", \"task_cycles\": " << task_cycles << ", \"cavity_cycles\": " << cavity_cycles
+		   << ", \"build_cycles\": " << build_cycles << ", \"redistribute_cycles\": " << redistribute_cycles
+		   << ", \"queue_wait_cycles\": " << queue_wait_cycles << "}";
+	}
+
+private:
+	static double ratio(uint64_t a, uint64_t b) {
+		return b ? double(a) / b : 0;
+	}
+	// percentage, for the text dump
+	static std::string rate(uint64_t a, uint64_t b) {
+		return std::to_string(100 * ratio(a, b)) + "%";
+	}
+};
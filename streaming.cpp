@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <tbb/blocked_range.h>
+#include <tbb/combinable.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include "streaming.h"
+#include "mesh_io.h"
+#include "point_io.h"
+#include "spatialsort.h"
+#include "triangulator.h"
+using namespace std;
+
+
+// Points bucketed by one task.
+static size_t const POINT_CHUNK = 1 << 16;
+// Points buffered per cell before they are written to the bucket file.
+static size_t const BUCKET_BUFFER = 1 << 10;
+
+// Grid of cells over the bounding box of the points, about num_cells of them, as
+// cubic as the extents allow. Cells are numbered in sweep order: the axis with the
+// smallest extent varies fastest and the longest slowest, so the front between the
+// inserted cells and the others is a cross section of the domain.
+class cell_grid {
+public:
+    cell_grid(span<xyz const> points, size_t num_cells, int num_threads)
+    {
+        xyz lo, hi;
+        lo.fill(numeric_limits<REAL>::max());
+        hi.fill(-numeric_limits<REAL>::max());
+        tbb::combinable<pair<xyz, xyz> > bounds([&] { return make_pair(lo, hi); });
+        tbb::task_arena arena(num_threads > 0 ? num_threads : int(tbb::task_arena::automatic));
+        arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, points.size(), POINT_CHUNK), [&](tbb::blocked_range<size_t> const& r) {
+                auto&& b = bounds.local();
+                for (size_t i = r.begin(); i < r.end(); ++i)
+                {
+                    for (int a = 0; a < 3; ++a)
+                    {
+                        b.first[a] = min(b.first[a], points[i][a]);
+                        b.second[a] = max(b.second[a], points[i][a]);
+                    }
+                }
+            });
+        });
+        bounds.combine_each([&](pair<xyz, xyz> const& b) {
+            for (int a = 0; a < 3; ++a)
+            {
+                lo[a] = min(lo[a], b.first[a]);
+                hi[a] = max(hi[a], b.second[a]);
+            }
+        });
+
+        // Pick the cell edge for the axes with some extent, dropping the axes
+        // thinner than one cell until the edge fits them all.
+        lo_ = lo;
+        REAL extent[3];
+        bool flat[3];
+        eps_ = 0;
+        for (int a = 0; a < 3; ++a)
+        {
+            extent[a] = max(hi[a] - lo[a], REAL(0));
+            flat[a] = !(extent[a] > 0);
+            eps_ = max(eps_, max(fabs(lo[a]), fabs(hi[a])));
+        }
+        eps_ = eps_ * 1e-12 + numeric_limits<REAL>::min();
+        REAL edge = 0;
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            REAL volume = 1;
+            int num_axes = 0;
+            for (int a = 0; a < 3; ++a)
+            {
+                if (flat[a])
+                    continue;
+                volume *= extent[a];
+                ++num_axes;
+            }
+            if (num_axes == 0)
+                break;
+            edge = pow(volume / max(num_cells, size_t(1)), 1.0 / num_axes);
+            for (int a = 0; a < 3; ++a)
+            {
+                if (!flat[a] && extent[a] < edge)
+                {
+                    flat[a] = true;
+                    changed = true;
+                }
+            }
+        }
+        for (int a = 0; a < 3; ++a)
+        {
+            dims_[a] = flat[a] ? 1 : int(min(ceil(extent[a] / edge), REAL(1 << 20)));
+            scale_[a] = flat[a] ? 0 : dims_[a] / extent[a];
+            axes_[a] = a;
+        }
+        sort(axes_, axes_ + 3, [&](int a, int b) { return extent[a] < extent[b]; });
+    }
+
+    size_t size() const
+    {
+        return size_t(dims_[0]) * dims_[1] * dims_[2];
+    }
+
+    size_t cell(xyz const& p) const
+    {
+        return order(index(p[0], 0), index(p[1], 1), index(p[2], 2));
+    }
+
+    // Return the last cell in sweep order that the box around the sphere touches.
+    // The radius is padded for the rounding of the circumsphere and of the cells.
+    size_t last_cell(xyz const& center, REAL radius) const
+    {
+        REAL r = radius * (1 + 1e-6) + eps_;
+        return order(index(center[0] + r, 0), index(center[1] + r, 1), index(center[2] + r, 2));
+    }
+
+private:
+    int index(REAL x, int a) const
+    {
+        REAL f = (x - lo_[a]) * scale_[a];
+        if (!(f > 0))
+            return 0;
+        if (f >= dims_[a])
+            return dims_[a] - 1;
+        return int(f);
+    }
+
+    size_t order(int i0, int i1, int i2) const
+    {
+        int i[3] = {i0, i1, i2};
+        return (size_t(i[axes_[2]]) * dims_[axes_[1]] + i[axes_[1]]) * dims_[axes_[0]] + i[axes_[0]];
+    }
+
+    xyz lo_;
+    REAL scale_[3];
+    int dims_[3];
+    // axes from the fastest to the slowest varying in sweep order
+    int axes_[3];
+    // absolute padding of spheres, above the rounding of the coordinates
+    REAL eps_;
+};
+
+static bool write_at(int fd, char const* data, size_t num, size_t offset)
+{
+    while (num > 0)
+    {
+        ssize_t done = pwrite(fd, data, num, offset);
+        if (done <= 0)
+            return false;
+        data += done;
+        num -= done;
+        offset += done;
+    }
+    return true;
+}
+
+static bool read_at(int fd, char* data, size_t num, size_t offset)
+{
+    while (num > 0)
+    {
+        ssize_t done = pread(fd, data, num, offset);
+        if (done <= 0)
+            return false;
+        data += done;
+        num -= done;
+        offset += done;
+    }
+    return true;
+}
+
+// Write the points to fd grouped by cell, in sweep order. offsets gets the first
+// point of each cell, and the number of points at the end.
+static bool bucket(span<xyz const> points, cell_grid const& grid, int fd, vector<size_t>& offsets, int num_threads)
+{
+    size_t num_cells = grid.size();
+    tbb::combinable<vector<size_t> > counts([num_cells] { return vector<size_t>(num_cells, 0); });
+    tbb::task_arena arena(num_threads > 0 ? num_threads : int(tbb::task_arena::automatic));
+    arena.execute([&] {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, points.size(), POINT_CHUNK), [&](tbb::blocked_range<size_t> const& r) {
+            auto&& c = counts.local();
+            for (size_t i = r.begin(); i < r.end(); ++i)
+                ++c[grid.cell(points[i])];
+        });
+    });
+    offsets.assign(num_cells + 1, 0);
+    counts.combine_each([&](vector<size_t> const& c) {
+        for (size_t i = 0; i < num_cells; ++i)
+            offsets[i + 1] += c[i];
+    });
+    partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+    vector<vector<xyz> > buffers(num_cells);
+    bool ok = true;
+    auto flush = [&](size_t c) {
+        auto&& buffer = buffers[c];
+        ok = ok && write_at(fd, reinterpret_cast<char const*>(buffer.data()), buffer.size() * sizeof(xyz), cursors[c] * sizeof(xyz));
+        cursors[c] += buffer.size();
+        buffer.clear();
+    };
+    for (size_t i = 0; i < points.size() && ok; ++i)
+    {
+        size_t c = grid.cell(points[i]);
+        buffers[c].push_back(points[i]);
+        if (buffers[c].size() == BUCKET_BUFFER)
+            flush(c);
+    }
+    for (size_t c = 0; c < num_cells; ++c)
+        flush(c);
+    return ok;
+}
+
+// Drives a triangulator through the cells, reaching into it to add points between
+// runs and to drop the finalized tetras.
+class stream_triangulator {
+public:
+    // Only the points of a cell wait in conflict lists, and a hierarchy would keep
+    // points of the finalized cells.
+    stream_triangulator(size_t num_points, int num_threads) :
+        tri_(num_threads, num_points, triangulator::CONFLICT_LISTS)
+    {
+    }
+
+    // Insert the points of cell, walking from a tetra in it if there is one.
+    template <typename CellOf>
+    void insert(vector<xyz> const& points, size_t cell, CellOf cell_of)
+    {
+        tri_.insert(points, find_hint(cell, cell_of));
+    }
+
+    template <typename IsFinal, typename Emit>
+    void finalize(IsFinal const& is_final, Emit emit)
+    {
+        tri_.finalize(is_final, emit);
+    }
+
+    size_t num_tetras() const
+    {
+        return tri_.pool_.size();
+    }
+
+    size_t num_resident_points() const
+    {
+        size_t ret = 0;
+        for (size_t page = 0; page < tri_.points_.num_pages(); ++page)
+        {
+            if (!tri_.points_.released(page))
+                ++ret;
+        }
+        return ret * point_store::PAGE_SIZE;
+    }
+
+private:
+    // Return a live finite tetra whose centroid is in cell, -1 if there is none.
+    template <typename CellOf>
+    tetra_k find_hint(size_t cell, CellOf cell_of) const
+    {
+        for (size_t t = 0; t < tri_.pool_.size(); ++t)
+        {
+            if (!tri_.is_alive(t) || tri_.is_infinite(t))
+                continue;
+            xyz centroid = {0, 0, 0};
+            for (auto&& v : tri_.pool_.vertices(t))
+            {
+                for (int a = 0; a < 3; ++a)
+                    centroid[a] += 0.25 * tri_.points_[v][a];
+            }
+            if (cell_of(centroid) == cell)
+                return t;
+        }
+        return -1;
+    }
+
+    triangulator tri_;
+};
+
+bool stream_triangulate(string const& input, string const& output, stream_options const& options, stream_stats* stats)
+{
+    int num_threads = options.num_threads > 0 ? options.num_threads : max(1, int(thread::hardware_concurrency()));
+    size_t num_points;
+    unique_ptr<cell_grid> grid;
+    vector<size_t> offsets;
+    string temp_path = options.temp_path.empty() ? output + ".cells" : options.temp_path;
+    int fd = open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    // the bucket file goes away with the descriptor
+    unlink(temp_path.c_str());
+    {
+        point_cloud cloud;
+        if (!load_points(input, cloud, num_threads))
+        {
+            ::close(fd);
+            return false;
+        }
+        span<xyz const> points = cloud.points();
+        num_points = points.size();
+        size_t num_cells = (num_points + options.cell_points - 1) / max(options.cell_points, size_t(1));
+        grid.reset(new cell_grid(points, num_cells, num_threads));
+        if (!bucket(points, *grid, fd, offsets, num_threads))
+        {
+            ::close(fd);
+            return false;
+        }
+    }
+
+    mesh_writer writer(output, options.level, num_threads);
+    stream_triangulator tri(num_points, num_threads);
+    size_t num_tetras = 0;
+    size_t peak_tetras = 0;
+    size_t peak_points = 0;
+    bool ok = writer.good();
+    auto emit = [&](span<tetra const> tetras) {
+        writer.write_tetras(tetras);
+        num_tetras += tetras.size();
+    };
+    auto cell_of = [&](xyz const& p) { return grid->cell(p); };
+    for (size_t c = 0; c < grid->size() && ok; ++c)
+    {
+        size_t num = offsets[c + 1] - offsets[c];
+        if (num == 0)
+            continue;
+        vector<xyz> points(num);
+        if (!read_at(fd, reinterpret_cast<char*>(points.data()), num * sizeof(xyz), offsets[c] * sizeof(xyz)))
+        {
+            ok = false;
+            break;
+        }
+        spatial_sort(points);
+        writer.write_points(span<xyz const>(points.data(), points.size()));
+        tri.insert(points, c, cell_of);
+        peak_tetras = max(peak_tetras, tri.num_tetras());
+        peak_points = max(peak_points, tri.num_resident_points());
+        // the cells up to c are complete
+        tri.finalize([&](xyz const& center, REAL radius) {
+            return grid->last_cell(center, radius) <= c;
+        }, emit);
+    }
+    tri.finalize([](xyz const&, REAL) { return true; }, emit);
+    ::close(fd);
+    ok = writer.close() && ok;
+
+    if (stats)
+    {
+        stats->num_points = num_points;
+        stats->num_tetras = num_tetras;
+        stats->num_cells = grid->size();
+        stats->peak_tetras = peak_tetras;
+        stats->peak_points = peak_points;
+    }
+    return ok;
+}
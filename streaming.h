@@ -0,0 +1,44 @@
+#ifndef STREAMING_H
+
+#define STREAMING_H
+
+#include <cstddef>
+#include <string>
+
+// Out-of-core Delaunay triangulation of point sets larger than memory.
+// The points are bucketed on disk into a grid of cells, and the cells are inserted
+// one by one, sweeping the domain along its longest axis. After each cell, the tetras
+// whose circumsphere only touches inserted cells can't change anymore: they are
+// written out and dropped, with the points no remaining tetra uses. Memory then
+// follows the tetras along the sweep front rather than the whole triangulation.
+
+struct stream_options {
+	// average number of points per cell
+	size_t cell_points;
+	// number of threads, 0 for all cores
+	int num_threads;
+	// zlib level of the output
+	int level;
+	// file holding the bucketed points while triangulating, output + ".cells" if empty
+	std::string temp_path;
+	stream_options() : cell_points(1 << 20), num_threads(0), level(1) {}
+};
+
+struct stream_stats {
+	size_t num_points;
+	size_t num_tetras;
+	size_t num_cells;
+	// most tetra slots and resident points at once
+	size_t peak_tetras;
+	size_t peak_points;
+};
+
+// Triangulate the points of input, in any format load_points reads, and write the
+// finite tetras to output as a binary mesh (mesh_io.h) without neighbors. The points
+// are written cell by cell, in the order of their keys, and duplicates are left out
+// of the tetras. Only packed double files (.bin, .f64) are read without loading them
+// whole. Return false if a file can't be read or written.
+bool stream_triangulate(std::string const& input, std::string const& output,
+		stream_options const& options = stream_options(), stream_stats* stats = nullptr);
+
+#endif /* end of include guard: STREAMING_H */
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "types.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+// POSIX
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Contiguous storage for the tetras of a triangulation, or the triangles of a 2D one.
+// The address range of max_size tetras is reserved up front and backed with memory
+// chunk by chunk, so the pool grows while other threads read it and does not move.
+// Once the range is full it moves to a larger one, between runs, see grow().
+// The triangulator reuses the slots of the tetras a cavity replaces for the new ones;
+// the slots left dead stay until the pool is compacted between runs.
+// A slot is its point keys, its neighbors and the head of its conflict list, 36 bytes
+// for a tetra, in three plain arrays. The face of a neighbor across which it sees a
+// tetra is not packed into the neighbor key: neighbors() hands the keys to callers as
+// they are, with their negative markers, and finding the face among D + 1 keys is cheap.
+template <int D>
+class simplex_pool {
+public:
+	typedef simplex<D> tetra;
+	typedef simplex_neighbors<D> tetra_neighbors;
+
+	// Head of an empty conflict list, and of the list of a dead tetra.
+	static point_k const NO_POINT = -1;
+	static point_k const DEAD = -2;
+
+	explicit simplex_pool(size_t max_size) :
+		max_size_(max_size), size_(0), committed_(0)
+	{
+		vertices_ = reserve<tetra>(max_size_);
+		neighbors_ = reserve<tetra_neighbors>(max_size_);
+		heads_ = reserve<point_k>(max_size_);
+	}
+	~simplex_pool() {
+		release(vertices_, max_size_);
+		release(neighbors_, max_size_);
+		release(heads_, max_size_);
+	}
+	simplex_pool(simplex_pool const&) = delete;
+	simplex_pool& operator=(simplex_pool const&) = delete;
+
+	// Return the first of num new consecutive slots, or -1 if the reserved range is
+	// full, see grow(). Throw std::bad_alloc, taking no slot, if there is no memory to
+	// back them. Thread safe.
+	tetra_k allocate(size_t num) {
+		size_t begin = size_.load();
+		do {
+			if (begin + num > max_size_) return -1;
+			if (begin + num > committed_.load(std::memory_order_acquire)) commit(begin + num);
+		} while (!size_.compare_exchange_weak(begin, begin + num));
+		std::fill(heads_ + begin, heads_ + begin + num, NO_POINT);
+		return begin;
+	}
+
+	// Reserve max_size slots instead, moving the slots to the new range; the keys stay.
+	// Throw std::bad_alloc, changing nothing, if the range or the memory of the slots
+	// can't be had. Only while no other thread uses the pool.
+	void grow(size_t max_size) {
+		if (max_size <= max_size_) return;
+		simplex_pool grown(max_size);
+		size_t size = this->size();
+		grown.commit(size);
+		std::copy(vertices_, vertices_ + size, grown.vertices_);
+		std::copy(neighbors_, neighbors_ + size, grown.neighbors_);
+		std::copy(heads_, heads_ + size, grown.heads_);
+		// the old range goes with grown
+		std::swap(max_size_, grown.max_size_);
+		std::swap(vertices_, grown.vertices_);
+		std::swap(neighbors_, grown.neighbors_);
+		std::swap(heads_, grown.heads_);
+		committed_.store(grown.committed_.load());
+	}
+
+	size_t size() const {
+		return size_.load();
+	}
+
+	// Drop every slot, keeping the memory backed for the next triangulation. Only while
+	// no other thread uses the pool.
+	void clear() {
+		size_.store(0);
+	}
+
+	// Number of slots reserved, the most the pool holds until it grows.
+	size_t max_size() const {
+		return max_size_;
+	}
+
+	tetra& vertices(tetra_k t) { return vertices_[t]; }
+	tetra const& vertices(tetra_k t) const { return vertices_[t]; }
+	tetra_neighbors& neighbors(tetra_k t) { return neighbors_[t]; }
+	tetra_neighbors const& neighbors(tetra_k t) const { return neighbors_[t]; }
+	// The first of the points whose region is t, not inserted yet, chained by their
+	// next keys (see basic_point_store::next()). Only the thread owning the points of
+	// t touches the list. NO_POINT if there is none, DEAD once t is replaced.
+	point_k& first_point(tetra_k t) { return heads_[t]; }
+	point_k first_point(tetra_k t) const { return heads_[t]; }
+	bool alive(tetra_k t) const { return load_first_point(t) != DEAD; }
+	void kill(tetra_k t) { store_first_point(t, DEAD); }
+
+	// The points and the head of slot t for a thread that does not own the slot while
+	// another may rewrite it, a triangulation task checking that a reused slot still
+	// holds its tetra, and for the owner writing them. Relaxed atomic accesses to the
+	// plain words, so the arrays keep the types tetras() and neighbors() expose.
+	tetra load_vertices(tetra_k t) const {
+		tetra ret;
+		for (int i = 0; i <= D; ++i) ret[i] = __atomic_load_n(&vertices_[t][i], __ATOMIC_RELAXED);
+		return ret;
+	}
+	void store_vertices(tetra_k t, tetra const& v) {
+		for (int i = 0; i <= D; ++i) __atomic_store_n(&vertices_[t][i], v[i], __ATOMIC_RELAXED);
+	}
+	point_k load_first_point(tetra_k t) const {
+		return __atomic_load_n(heads_ + t, __ATOMIC_RELAXED);
+	}
+	void store_first_point(tetra_k t, point_k k) {
+		__atomic_store_n(heads_ + t, k, __ATOMIC_RELAXED);
+	}
+
+	span<tetra const> vertices() const { return span<tetra const>(vertices_, size()); }
+	span<tetra_neighbors const> neighbors() const { return span<tetra_neighbors const>(neighbors_, size()); }
+
+	// Move slot t to new_keys[t], or drop it if new_keys[t] is -1. The kept slots must
+	// keep their order and be numbered from 0. Neighbors are copied as they are, the
+	// caller renumbers them. Only while no other thread uses the pool.
+	// The memory of the slots past the new size is handed back to the system.
+	void compact(std::vector<tetra_k> const& new_keys) {
+		size_t size = this->size();
+		size_t new_size = 0;
+		for (size_t t = 0; t < size; ++t) {
+			tetra_k k = new_keys[t];
+			if (k == -1) continue;
+			new_size = k + 1;
+			if (size_t(k) == t) continue;
+			vertices_[k] = vertices_[t];
+			neighbors_[k] = neighbors_[t];
+			heads_[k] = heads_[t];
+		}
+		size_.store(new_size);
+		size_t committed = committed_.load();
+		discard(vertices_, new_size, committed);
+		discard(neighbors_, new_size, committed);
+		discard(heads_, new_size, committed);
+	}
+
+private:
+	// Number of slots backed with memory at a time.
+	static size_t const CHUNK_SIZE = 1 << 16;
+
+	template <typename T>
+	static T* reserve(size_t num) {
+		void* p = mmap(nullptr, bytes<T>(num), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) throw std::bad_alloc();
+		return static_cast<T*>(p);
+	}
+	template <typename T>
+	static void release(T* p, size_t num) {
+		munmap(p, bytes<T>(num));
+	}
+	// Make [begin, end) of the reserved range readable and writable.
+	template <typename T>
+	static void back(T* p, size_t begin, size_t end) {
+		size_t page = sysconf(_SC_PAGESIZE);
+		size_t first = begin * sizeof(T) / page * page;
+		size_t last = bytes<T>(end);
+		if (mprotect(reinterpret_cast<char*>(p) + first, last - first, PROT_READ | PROT_WRITE) != 0) {
+			throw std::bad_alloc();
+		}
+	}
+	// Give the memory of [begin, end) back, it reads as zeros when touched again.
+	template <typename T>
+	static void discard(T* p, size_t begin, size_t end) {
+		size_t first = bytes<T>(begin);
+		size_t last = bytes<T>(end);
+		if (last > first) madvise(reinterpret_cast<char*>(p) + first, last - first, MADV_DONTNEED);
+	}
+	template <typename T>
+	static size_t bytes(size_t num) {
+		size_t page = sysconf(_SC_PAGESIZE);
+		return (num * sizeof(T) + page - 1) / page * page;
+	}
+
+	void commit(size_t end) {
+		std::lock_guard<std::mutex> lock(commit_mutex_);
+		size_t committed = committed_.load(std::memory_order_relaxed);
+		if (end <= committed) return;
+		size_t new_committed = std::min(max_size_, (end + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE);
+		back(vertices_, committed, new_committed);
+		back(neighbors_, committed, new_committed);
+		back(heads_, committed, new_committed);
+		committed_.store(new_committed, std::memory_order_release);
+	}
+
+	size_t max_size_;
+	std::atomic<size_t> size_;
+	std::atomic<size_t> committed_;
+	std::mutex commit_mutex_;
+	tetra* vertices_;
+	tetra_neighbors* neighbors_;
+	point_k* heads_;
+};
+
+template <int D>
+point_k const simplex_pool<D>::NO_POINT;
+template <int D>
+point_k const simplex_pool<D>::DEAD;
+
+typedef simplex_pool<3> tetra_pool;
@@ -3,21 +3,28 @@
 #define NUM_THREAD 4
 
 #include "types.h"
+#include "dimension.h"
+#include "point_store.h"
+#include "tetra_pool.h"
 
 // STL
 #include <array>
 #include <vector>
 #include <mutex>
 #include <memory>
+#include <atomic>
 #include <unordered_set>
 #include <algorithm>
-// Boost
-#include <boost/functional/hash.hpp>
-
+#include <numeric>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <stdexcept>
 // TBB
-#include <tbb/concurrent_hash_map.h>
-//#include <tbb/task.h>
-//#include <tbb/task_scheduler_init.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
 // declare the functions in predicates.c
 #include "predicates.h"
@@ -28,457 +35,2377 @@
 #	define CUT_OFF_SIZE 0
 #endif
 
+// Most points a task inserts, the first of its tetra and then those of the new tetras,
+// before it unlocks them and hands the tetras left to new tasks. 1 for a task per point.
+#ifndef TASK_BATCH_POINTS
+#	define TASK_BATCH_POINTS 8
+#endif
+
+// Tetra slots reserved per input point. The new tetras of a cavity take the slots of
+// those they replace first, so the pool holds about the tetras alive, 6.7 per point
+// for points spread in 3D. Point sets with more tetras, up to quadratically many,
+// grow the pool, see grow_pool().
+#ifndef POOL_SLOTS_PER_POINT
+#	define POOL_SLOTS_PER_POINT 8
+#endif
+
+// Triangulations of at least HIERARCHY_MIN_POINTS points locate them with a Delaunay
+// hierarchy unless told otherwise, see triangulator::location_mode.
+#ifndef HIERARCHY_MIN_POINTS
+#	define HIERARCHY_MIN_POINTS (1 << 25)
+#endif
+// Most points in conflict lists at a time with a hierarchy, the points of a round.
+#ifndef HIERARCHY_MAX_ROUND
+#	define HIERARCHY_MAX_ROUND (1 << 20)
+#endif
+
 #include "job_queue.h"
+#include "quality.h"
+#include "spatialsort.h"
+#include "stats.h"
 
 //#define DEBUG
 
 using namespace std;
 
-class triangulator {
+// Finite tetras of a triangulation with dead slots removed, triangles in 2D.
+// neighbors[t][i] is the tetra across the face opposite tetras[t][i], -1 on the convex hull.
+// If the vertices are renumbered, vertex v is the point of key points[v] of the
+// triangulation; points is empty if the tetras use the point keys.
+template <int D>
+struct simplex_mesh {
+	std::vector<simplex<D> > tetras;
+	std::vector<simplex_neighbors<D> > neighbors;
+	std::vector<point_k> points;
+};
+typedef simplex_mesh<3> tetra_mesh;
+
+// The Delaunay triangulation of points in D = 3 or 2 dimensions. The code is written
+// for tetras, and reads the same for the triangles of 2D with D + 1 points each; what
+// differs is in dimension<D>. Parts marked 3D only do not compile for 2D.
+// Coordinates are T: float points are stored as floats, half the memory and bandwidth
+// of doubles, and widened exactly for the predicates, see exact_coords(). Parts marked
+// double only do not compile for float.
+template <int D, typename T = REAL>
+class basic_async_triangulation;
+
+template <int D, typename T = REAL>
+class basic_triangulator {
 public:
+	typedef std::array<T, 3> point_type;
+	// A tetra of D + 1 point keys and its neighbors, a triangle in 2D.
+	typedef simplex<D> tetra;
+	typedef simplex_neighbors<D> tetra_neighbors;
+	// A face of a tetra, an edge in 2D.
+	typedef std::array<point_k, D> face;
+
 	int get_num_jobs() const {
 		return job_queue_.get_num_jobs();
 	}
+	// Counters and timers of the tasks run so far, all zero unless built with
+	// TRIANGULATOR_STATS (make STATS=1).
+	triangulation_stats const& stats() const {
+		return stats_;
+	}
+	// Points inserted or dropped so far, as duplicates or hidden, at most num_points().
+	// Counted by the tasks as they finish, read it from another thread while inserting.
+	size_t num_processed() const {
+		return num_processed_.load(std::memory_order_relaxed);
+	}
+	// Stop inserting, from another thread: the tasks not started yet are dropped, so
+	// the insertion running returns once the running ones are done, and later ones
+	// return at once. The triangulation is left with the points inserted so far, the
+	// others wait in conflict lists for good; only destroy it, which is cheap.
+	void cancel() {
+		job_queue_.cancel();
+		if (coarser_) coarser_->cancel();
+	}
+	bool cancelled() const {
+		return job_queue_.cancelled();
+	}
+	// How the points waiting for insertion find the tetra they go in.
+	enum location_mode {
+		// Every point waits in the conflict list of the tetra whose region holds it, and
+		// moves to a new tetra whenever that one is replaced. Fastest, but the lists take
+		// memory for every point not inserted yet.
+		CONFLICT_LISTS,
+		// Points are inserted in rounds of at most HIERARCHY_MAX_ROUND, and located
+		// when their round starts by walking down a Delaunay hierarchy: coarser
+		// triangulations of random samples of the points, one in HIERARCHY_RATIO of
+		// the level below. Only the points of a round are in conflict lists.
+		HIERARCHY,
+		// HIERARCHY from HIERARCHY_MIN_POINTS points on, CONFLICT_LISTS below
+		AUTOMATIC_LOCATION
+	};
+	// How the threads insert points.
+	enum insertion_mode {
+		// Tasks from a queue lock the points of the cavity of a point, and try again
+		// later when another task holds one of them.
+		LOCKING_TASKS,
+		// Rounds: every tetra holding points finds the cavity of its first point, in
+		// parallel and reading only, then a maximal set of these points whose cavities
+		// do not touch, picked by priority, is inserted in parallel. No lock, and the
+		// same input gives the same triangulation whatever the threads. Refinement
+		// still runs tasks.
+		ROUNDS
+	};
+
 	// Triangulate the points
-	triangulator(std::vector<xyz> const& xyzs, int num_thread) : job_queue_(num_thread) {
-		//size_t n = xyzs.size();
-           int n = xyzs.size();
-	    // Get hull tetra
-	    std::array<xyz, 4> hull_xyzs = get_hull_xyzs(xyzs);
-	    tetra hull_tetra = {n, n + 1, n + 2, n + 3};
-	    // Init point_datas_
-	    point_datas_.reset(new point_data[n + 4]);
-	    for (size_t i = 0; i < n; ++i) {
-		auto&& point_data = point_datas_[i];
-		point_data.pos = xyzs[i];
-	    }
-	    for (size_t i = 0; i < 4; ++i) {
-		auto&& point_data = point_datas_[n + i];
-		point_data.pos = hull_xyzs[i];
-	    }
-	    // Prepare points_in_tetra
-            tetra_data t_data;
-	    t_data.pts_intetra.reserve(n);
-	    for (point_k i = 0; i < n; ++i) t_data.pts_intetra.push_back(i);
-
-            for (size_t i = 0; i < 4; i++) {
-                for (size_t j = 0; j < 4; j++)
-                    t_data.neighbor[i][j] = -1;
-            }
-        
-            // init tetra_to_points_ only have one single tetra
-	    tetra_to_points_.insert(tetra_map::value_type(hull_tetra, std::make_shared<tetra_data>(t_data)));
-        
-            // init to use predicate.c
-            exactinit();
-
-	    // Spawn task
-	    run_root_task(hull_tetra);
-	}
-
-	// Return triangulation result.
+	basic_triangulator(std::vector<point_type> const& xyzs, int num_thread, location_mode mode = AUTOMATIC_LOCATION,
+		insertion_mode insertion = LOCKING_TASKS) :
+		basic_triangulator(span<point_type const>(xyzs.data(), xyzs.size()), num_thread, mode, insertion)
+	{
+	}
+	// Triangulate the points without copying them. The points must outlive the triangulator.
+	// Less than D + 1 points or all points coplanar (collinear in 2D) gives an empty
+	// triangulation.
+	basic_triangulator(span<point_type const> xyzs, int num_thread, location_mode mode = AUTOMATIC_LOCATION,
+		insertion_mode insertion = LOCKING_TASKS) :
+		basic_triangulator(num_thread, xyzs.size(), mode, insertion)
+	{
+		points_.assign(xyzs);
+		insert_pending();
+	}
+	// The regular triangulation of weighted points: the conflict test is the power test
+	// of predicates.h, the weight of a point is weights[k]. A point no tetra is in
+	// conflict with is hidden by the others and dropped, and a vertex inside the cavity
+	// of a heavier point disappears. The points and weights must outlive the triangulator.
+	// 3D only.
+	basic_triangulator(span<point_type const> xyzs, span<REAL const> weights, int num_thread, location_mode mode = AUTOMATIC_LOCATION,
+		insertion_mode insertion = LOCKING_TASKS) :
+		basic_triangulator(num_thread, xyzs.size(), mode, insertion)
+	{
+		static_assert(D == 3, "weighted triangulations are 3D only");
+		weighted_ = true;
+		points_.assign(xyzs, weights);
+		insert_pending();
+	}
+	// An empty triangulation growing by insert(), for up to max_points points in all.
+	// max_points sizes the address range reserved for the tetras, memory is only used
+	// as the triangulation grows.
+	basic_triangulator(int num_thread, size_t max_points, location_mode mode = AUTOMATIC_LOCATION,
+		insertion_mode insertion = LOCKING_TASKS) :
+		job_queue_(num_thread), num_thread_(num_thread), pool_(POOL_SLOTS_PER_POINT * max_points + 1024),
+		inf_(std::numeric_limits<point_k>::max()), hull_hint_(-1), inserted_(0), num_dead_(0), num_processed_(0), pool_full_(false),
+		weighted_(false),
+		hierarchy_(mode == HIERARCHY || (mode == AUTOMATIC_LOCATION && max_points >= HIERARCHY_MIN_POINTS)), sampled_(0),
+		rounds_(insertion == ROUNDS),
+		refine_first_(inf_)
+	{
+		// init to use predicate.c
+		exactinit();
+		STATS(worker_stats_.resize(num_thread));
+		worker_tasks_.assign(std::max(1, num_thread), triangulation_task(this, -1));
+		// the sample of a level is about max_points / HIERARCHY_RATIO points, leave room
+		if (hierarchy_ && max_points / HIERARCHY_RATIO >= HIERARCHY_MIN_LEVEL) {
+			coarser_.reset(new basic_triangulator(num_thread, 2 * max_points / HIERARCHY_RATIO + 1024, HIERARCHY, insertion));
+		}
+	}
+
+	// Insert a batch of points into the triangulation, keeping the tetras the batch
+	// does not touch. The points are copied and get consecutive keys, the first one
+	// is returned. Each point is located by walking from hint if it is a live tetra,
+	// else from the hull, then from the previous point of the batch, so batches in
+	// spatial order (spatial_sort) walk the least; with a hierarchy the walks start
+	// from it instead. Points at the position of an existing point are dropped.
+	// Tetra keys are slots: the tetras the batch replaces hand their slots to new ones,
+	// so a key held across insert() names a live tetra or a dead slot, maybe not the
+	// tetra it named, and only compact_pool() renumbers the slots.
+	// Not thread safe, one batch at a time.
+	point_k insert(span<point_type const> xyzs, tetra_k hint = -1) {
+		point_k first = points_.append(xyzs);
+		if (hint != -1 && (size_t(hint) >= pool_.size() || !is_alive(hint))) hint = -1;
+		insert_pending(hint);
+		return first;
+	}
+	point_k insert(std::vector<point_type> const& xyzs, tetra_k hint = -1) {
+		return insert(span<point_type const>(xyzs.data(), xyzs.size()), hint);
+	}
+
+	// Drop the triangulation and triangulate the points instead, without copying them,
+	// in the memory of the tetras and point locks of the last one: a triangulator per
+	// thread goes through many small sets allocating almost nothing. The points must
+	// outlive the triangulation, and be at most the max_points it was made for.
+	void reset(span<point_type const> xyzs) {
+		clear();
+		points_.assign(xyzs);
+		insert_pending();
+	}
+	// Insert a batch of weighted points, making the triangulation a regular one.
+	// Points inserted without weights weigh 0. 3D only.
+	point_k insert(span<point_type const> xyzs, span<REAL const> weights, tetra_k hint = -1) {
+		static_assert(D == 3, "weighted triangulations are 3D only");
+		weighted_ = true;
+		point_k first = points_.append(xyzs, weights);
+		if (hint != -1 && (size_t(hint) >= pool_.size() || !is_alive(hint))) hint = -1;
+		insert_pending(hint);
+		return first;
+	}
+
+	// Number of points handed to the triangulation, duplicates and hidden points included.
+	size_t num_points() const {
+		return points_.size();
+	}
+
+	// Position of point k, input or added by refine().
+	point_type const& point(point_k k) const {
+		return points_[k];
+	}
+
+	bool is_weighted() const {
+		return weighted_;
+	}
+
+	// Remove vertex v and fill its star with the Delaunay (or regular) tetras of its
+	// link. The walk to v starts from hint if it is a live tetra, see incident_tetras().
+	// Return false, leaving the triangulation as it was, if v is not a vertex, if the
+	// other points would be coplanar, or if cospherical points of the link make its
+	// triangulation miss a face of the star. Points v hid are not brought back.
+	// Not thread safe, 3D only.
+	bool remove(point_k v, tetra_k hint = -1) {
+		static_assert(D == 3, "remove() is 3D only");
+		std::vector<tetra_k> star;
+		return get_star(v, hint, star) && fill_star(v, star);
+	}
+
+	// Removed vertices stay in the coarser levels of a hierarchy, where they only make
+	// location start farther from the points around them.
+
+	// Move vertex v to p, keeping its key. While the tetras around v stay positively
+	// oriented and locally Delaunay, and v is off the hull, only its position changes.
+	// Otherwise v is removed and inserted again at p; at the position of another point
+	// it is then dropped like a duplicate. Return false, leaving v where it was, if
+	// it can't be removed. Not thread safe, 3D only.
+	bool move(point_k v, point_type const& p, tetra_k hint = -1) {
+		static_assert(D == 3, "move() is 3D only");
+		std::vector<tetra_k> star;
+		if (!get_star(v, hint, star)) return false;
+		point_type old = points_[v];
+		points_.set(v, p);
+		if (keeps_delaunay(v, star)) return true;
+		points_.set(v, old);
+		if (!fill_star(v, star)) return false;
+		points_.set(v, p);
+		// the first slot of the star holds a tetra of the fill
+		reinsert(v, star[0]);
+		return true;
+	}
+
+	// Delaunay refinement: insert the circumcenter of every finite tetra whose circumradius
+	// is more than max_ratio times its shortest edge, until there is none left or the
+	// triangulation has max_points points. The points and the tetra pool grow as needed,
+	// past the max_points the triangulator was made for, so a triangulator made from a
+	// point vector refines too. Each round inserts the circumcenters of the bad tetras
+	// as tasks of the job queue, ahead of the other tasks and worst tetras first. A
+	// circumcenter outside the convex hull is not inserted, the hull is the domain
+	// refined. A ratio of at least 2 is reached with a finite number of points, so
+	// max_points 0 sets no limit for it; a smaller ratio may take points without end,
+	// and throws std::invalid_argument without a max_points. A circumcenter whose tetra
+	// is replaced before its turn is dropped, as it would be by inserting them one at a
+	// time, and its key is not a vertex. Return the number of keys the circumcenters took.
+	// Only for unweighted triangulations, not thread safe, 3D and double only.
+	size_t refine(REAL max_ratio, size_t max_points = 0) {
+		static_assert(D == 3 && std::is_same<T, REAL>::value, "refine() is 3D and double only");
+		if (max_points == 0 && max_ratio < 2) throw std::invalid_argument("refine: a ratio below 2 needs max_points");
+		if (weighted_ || pool_.size() == 0) return 0;
+		if (max_points == 0) max_points = std::numeric_limits<size_t>::max();
+		size_t added = 0;
+		while (points_.size() < max_points && !cancelled()) {
+			std::vector<refinement> bad = find_bad_tetras(max_ratio);
+			size_t room = max_points - points_.size();
+			if (bad.size() > room) bad.resize(room);
+			if (bad.empty()) break;
+			std::vector<xyz> centers(bad.size());
+			for (size_t k = 0; k < bad.size(); ++k) centers[k] = bad[k].center;
+			point_k first = points_.append(span<xyz const>(centers.data(), centers.size()));
+			if (coarser_) incident_.resize(points_.size(), -1);
+			inserted_ = points_.size();
+			refine_first_ = first;
+			refine_sources_.resize(bad.size());
+			for (size_t k = 0; k < bad.size(); ++k) {
+				refine_sources_[k] = std::make_pair(bad[k].source, pool_.vertices(bad[k].source));
+				push_point(bad[k].tetra, first + k);
+				job_queue_.push_job(triangulation_job{this, bad[k].tetra}, job_queue::RANDOM_PRIORITIES + int(bad.size() - k));
+			}
+			size_t size = pool_.size(), num_dead = num_dead_.load();
+			run_jobs();
+			STATS(collect_stats());
+			refine_first_ = inf_;
+			added += bad.size();
+			// every circumcenter was a duplicate
+			if (pool_.size() == size && num_dead_.load() == num_dead) break;
+		}
+		return added;
+	}
+
+	// Dihedral angles of the finite tetras, those with one below sliver_angle counted as
+	// slivers. Computed in parallel, 3D and double only.
+	dihedral_stats dihedral_angles(REAL sliver_angle = 5) const {
+		static_assert(D == 3 && std::is_same<T, REAL>::value, "dihedral_angles() is 3D and double only");
+		size_t size = pool_.size();
+		size_t num_blocks = (size + COMPACT_GRAIN - 1) / COMPACT_GRAIN;
+		std::vector<dihedral_stats> blocks(num_blocks, dihedral_stats(sliver_angle));
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+				for (size_t t = b * COMPACT_GRAIN; t < std::min(size, (b + 1) * COMPACT_GRAIN); ++t) {
+					if (!is_alive(t) || is_infinite(t)) continue;
+					auto&& v = pool_.vertices(t);
+					blocks[b].add(points_[v[0]], points_[v[1]], points_[v[2]], points_[v[3]]);
+				}
+			});
+		});
+		dihedral_stats ret(sliver_angle);
+		for (auto&& b : blocks) ret += b;
+		return ret;
+	}
+
+	// Remove slivers, finite tetras with a dihedral angle below sliver_angle, by moving
+	// their vertices. A vertex tries PERTURB_TRIES random moves of up to PERTURB_STEP
+	// of its shortest edge, off the face across the sliver, and keeps the one that makes
+	// the smallest dihedral angle around it largest. Only moves keeping the tetras around
+	// it positively oriented and locally Delaunay count, so the tetras stay the same and
+	// the vertices of a round move in parallel: each locks itself and its neighbors, and
+	// one whose neighbors are taken waits for the next round. Vertices on the hull stay.
+	// Read the new positions with point(). Only for unweighted triangulations, not
+	// thread safe, 3D and double only.
+	sliver_report perturb_slivers(REAL sliver_angle = 5, int max_rounds = 8) {
+		static_assert(D == 3 && std::is_same<T, REAL>::value, "perturb_slivers() is 3D and double only");
+		sliver_report report;
+		report.before = dihedral_angles(sliver_angle);
+		if (weighted_) max_rounds = 0;
+		points_.own_pages();
+		tbb::task_arena arena(num_thread_);
+		for (; report.rounds < max_rounds; ++report.rounds) {
+			std::vector<std::pair<point_k, tetra_k> > vertices = sliver_vertices(sliver_angle);
+			std::atomic<size_t> moved(0);
+			std::atomic<size_t> waiting(0);
+			arena.execute([&] {
+				tbb::parallel_for(tbb::blocked_range<size_t>(0, vertices.size(), PERTURB_GRAIN), [&](tbb::blocked_range<size_t> const& r) {
+					unsigned seed = r.begin();
+					for (size_t k = r.begin(); k < r.end(); ++k) {
+						int res = perturb_vertex(vertices[k].first, vertices[k].second, seed);
+						if (res > 0) moved.fetch_add(1, std::memory_order_relaxed);
+						if (res < 0) waiting.fetch_add(1, std::memory_order_relaxed);
+					}
+				});
+			});
+			report.moves += moved;
+			if (moved == 0 && waiting == 0) break;
+		}
+		report.after = dihedral_angles(sliver_angle);
+		return report;
+	}
+
+	// Locate query points in parallel: ret[i] is a live finite tetra holding queries[i],
+	// inside or on its boundary, and -1 outside the convex hull. Queries are walked in
+	// spatial_sort order, each block of them starting from the tetra of a coarse grid
+	// over the tetras and then from the tetra of the previous query. The grid is built
+	// for each call, so large batches pay for it best. The keys hold until the next
+	// change of the tetras, see insert(), and compact_pool(). 3D and double only.
+	std::vector<tetra_k> locate(span<xyz const> queries) const {
+		static_assert(D == 3 && std::is_same<T, REAL>::value, "locate() is 3D and double only");
+		std::vector<tetra_k> ret(queries.size(), -1);
+		if (pool_.size() == 0) return ret;
+		std::vector<size_t> order = spatial_sort_order(queries);
+		locate_grid grid = make_locate_grid();
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(tbb::blocked_range<size_t>(0, order.size(), LOCATE_GRAIN), [&](tbb::blocked_range<size_t> const& r) {
+				unsigned seed = r.begin();
+				tetra_k hint = -1;
+				for (size_t k = r.begin(); k < r.end(); ++k) {
+					REAL* q = const_cast<REAL*>(queries[order[k]].data());
+					if (hint == -1) hint = grid.cells[grid.cell(q)];
+					if (hint == -1) hint = hull_hint_;
+					tetra_k t = walk(hint, q, seed);
+					if (t == -1) t = scan(q);
+					hint = t;
+					if (t == -1) continue;
+					int i = infinite_index(t);
+					if (i != -1) {
+						// only a query on a hull face is in the finite tetra across it
+						tetra_k nei = pool_.neighbors(t)[i];
+						auto&& v = pool_.vertices(t);
+						if (nei < 0 || orient3d(pos(v[facet(i, 0)]), pos(v[facet(i, 1)]), pos(v[facet(i, 2)]), q) != 0) continue;
+						t = nei;
+					}
+					ret[order[k]] = t;
+				}
+			});
+		});
+		return ret;
+	}
+
+	// Barycentric coordinates of q in the finite tetra t, the weights of tetras()[t].
+	// 3D and double only.
+	std::array<REAL, 4> barycentric(tetra_k t, xyz const& q) const {
+		static_assert(D == 3 && std::is_same<T, REAL>::value, "barycentric() is 3D and double only");
+		auto&& v = pool_.vertices(t);
+		REAL* p[4] = {pos(v[0]), pos(v[1]), pos(v[2]), pos(v[3])};
+		REAL vol = orient3dfast(p[0], p[1], p[2], p[3]);
+		std::array<REAL, 4> ret;
+		for (int i = 0; i < 4; ++i) {
+			REAL* saved = p[i];
+			p[i] = const_cast<REAL*>(q.data());
+			ret[i] = orient3dfast(p[0], p[1], p[2], p[3]) / vol;
+			p[i] = saved;
+		}
+		return ret;
+	}
+
+	// A live tetra around each point, -1 for the points that are not vertices, as
+	// hints for remove() and move().
+	std::vector<tetra_k> incident_tetras() const {
+		std::vector<tetra_k> ret(points_.size(), -1);
+		for (size_t t = 0; t < pool_.size(); ++t) {
+			if (!is_alive(t)) continue;
+			for (auto&& v : pool_.vertices(t)) {
+				if (v != inf_) ret[v] = t;
+			}
+		}
+		return ret;
+	}
+
+	// Return triangulation result, finite tetras only.
 	std::vector<tetra> triangulate() {
-		std::vector<tetra> ret;
-		ret.reserve(tetra_to_points_.size());
-		for (auto&& tp : tetra_to_points_) {
-			ret.push_back(tp.first);
+		return compact(false).tetras;
+	}
+
+	// Return the finite tetras, and their neighbors if with_neighbors, with dead and
+	// infinite slots removed. Slots are renumbered in parallel in pool order.
+	simplex_mesh<D> compact(bool with_neighbors = true) {
+		simplex_mesh<D> ret;
+		size_t size = pool_.size();
+		size_t num_blocks = (size + COMPACT_GRAIN - 1) / COMPACT_GRAIN;
+		std::vector<tetra_k> new_keys(size);
+		std::vector<size_t> offsets(num_blocks + 1, 0);
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			// count the kept slots of each block
+			tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+				size_t count = 0;
+				for (size_t t = b * COMPACT_GRAIN; t < std::min(size, (b + 1) * COMPACT_GRAIN); ++t) {
+					new_keys[t] = is_alive(t) && !is_infinite(t) ? count++ : -1;
+				}
+				offsets[b + 1] = count;
+			});
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+			ret.tetras.resize(offsets[num_blocks]);
+			tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+				for (size_t t = b * COMPACT_GRAIN; t < std::min(size, (b + 1) * COMPACT_GRAIN); ++t) {
+					if (new_keys[t] == -1) continue;
+					new_keys[t] += offsets[b];
+					ret.tetras[new_keys[t]] = pool_.vertices(t);
+				}
+			});
+			if (!with_neighbors) return;
+			ret.neighbors.resize(offsets[num_blocks]);
+			tbb::parallel_for(size_t(0), size, [&](size_t t) {
+				if (new_keys[t] == -1) return;
+				auto&& nei = pool_.neighbors(t);
+				auto&& new_nei = ret.neighbors[new_keys[t]];
+				// a neighbor finalize() emitted is FINAL_TETRA, gone like an infinite one
+				for (int i = 0; i <= D; ++i) new_nei[i] = nei[i] < 0 ? -1 : new_keys[nei[i]];
+			});
+		});
+		return ret;
+	}
+
+	// compact(), with the vertices renumbered in spatial sort order and the tetras in
+	// the spatial sort order of their centroids, so that tetras close in space are
+	// close in memory and share vertices close in memory. Slots scattered over the
+	// pool by cavity rewrites are gathered, which speeds up solvers sweeping the mesh.
+	// The vertices are numbered from 0, see simplex_mesh::points.
+	simplex_mesh<D> compact_sorted(bool with_neighbors = true) {
+		simplex_mesh<D> mesh = compact(with_neighbors);
+		simplex_mesh<D> ret;
+		size_t num_tetras = mesh.tetras.size();
+		// the vertices, 2D ones sorted by their x and y only
+		std::vector<point_k> new_vertex(points_.size(), -1);
+		for (auto&& t : mesh.tetras) {
+			for (auto&& v : t) new_vertex[v] = 0;
+		}
+		for (point_k k = 0; k < point_k(new_vertex.size()); ++k) {
+			if (new_vertex[k] == 0) ret.points.push_back(k);
+		}
+		std::vector<xyz> positions(std::max(ret.points.size(), num_tetras));
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), ret.points.size(), [&](size_t v) {
+				positions[v] = sort_position(points_[ret.points[v]]);
+			});
+		});
+		std::vector<size_t> order = spatial_sort_order(span<xyz const>(positions.data(), ret.points.size()));
+		std::vector<point_k> keys(ret.points.size());
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), order.size(), [&](size_t v) {
+				keys[v] = ret.points[order[v]];
+				new_vertex[keys[v]] = v;
+			});
+		});
+		ret.points.swap(keys);
+		// the tetras, by their centroids, summed as the order is the same
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), num_tetras, [&](size_t t) {
+				xyz c = {0, 0, 0};
+				for (auto&& v : mesh.tetras[t]) {
+					xyz p = sort_position(points_[v]);
+					for (int i = 0; i < 3; ++i) c[i] += p[i];
+				}
+				positions[t] = c;
+			});
+		});
+		order = spatial_sort_order(span<xyz const>(positions.data(), num_tetras));
+		std::vector<tetra_k> new_tetra(num_tetras);
+		ret.tetras.resize(num_tetras);
+		if (with_neighbors) ret.neighbors.resize(num_tetras);
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), num_tetras, [&](size_t t) {
+				new_tetra[order[t]] = t;
+			});
+			tbb::parallel_for(size_t(0), num_tetras, [&](size_t t) {
+				auto&& old = mesh.tetras[order[t]];
+				for (int i = 0; i <= D; ++i) ret.tetras[t][i] = new_vertex[old[i]];
+				if (!with_neighbors) return;
+				auto&& nei = mesh.neighbors[order[t]];
+				for (int i = 0; i <= D; ++i) ret.neighbors[t][i] = nei[i] == -1 ? -1 : new_tetra[nei[i]];
+			});
+		});
+		return ret;
+	}
+
+	// Vertices of every slot in the tetra pool, without copying.
+	// Dead slots are left in place until compact_pool(), see is_alive(). Infinite tetras
+	// contain infinite_vertex().
+	span<tetra const> tetras() const {
+		return pool_.vertices();
+	}
+
+	// Neighbors of every slot in the tetra pool, without copying.
+	// Neighbor i of a live tetra is the live tetra across the face opposite its point i.
+	span<tetra_neighbors const> neighbors() const {
+		return pool_.neighbors();
+	}
+
+	bool is_alive(tetra_k t) const {
+		return pool_.alive(t);
+	}
+
+	// Number of dead slots in the tetra pool, left by cavities replaced with fewer
+	// tetras and by removals.
+	size_t num_dead() const {
+		return num_dead_.load();
+	}
+
+	// Drop the dead slots of the tetra pool, keeping the order of the live tetras, and
+	// return the new key of each old one, -1 for a dead one. Keys held by the caller,
+	// from locate(), tetras() or neighbors() or kept as hints, are only renumbered here
+	// and by finalize(); map them through the result. Not thread safe.
+	std::vector<tetra_k> compact_pool() {
+		size_t size = pool_.size();
+		std::vector<tetra_k> new_keys(size, -1);
+		tetra_k count = 0;
+		for (size_t t = 0; t < size; ++t) {
+			if (is_alive(t)) new_keys[t] = count++;
+		}
+		compact_pool(new_keys, count);
+		return new_keys;
+	}
+
+	// Return the faces of the convex hull, counterclockwise when seen from outside, in
+	// 2D its edges counterclockwise around it. Walks the infinite tetras only, so the
+	// cost is proportional to the hull size.
+	std::vector<face> convex_hull() const {
+		std::vector<face> ret;
+		if (pool_.size() == 0) return ret;
+		std::unordered_set<tetra_k> visited;
+		std::vector<tetra_k> stack;
+		visited.insert(hull_hint_);
+		stack.push_back(hull_hint_);
+		while (!stack.empty()) {
+			tetra_k t = stack.back();
+			stack.pop_back();
+			auto&& v = pool_.vertices(t);
+			int i = infinite_index(t);
+			face f;
+			for (int j = 0; j < D; ++j) f[j] = v[facet(i, j)];
+			std::swap(f[D - 2], f[D - 1]);
+			ret.push_back(f);
+			for (int j = 0; j <= D; ++j) {
+				tetra_k nei = pool_.neighbors(t)[j];
+				if (j != i && visited.insert(nei).second) {
+					stack.push_back(nei);
+				}
+			}
 		}
 		return ret;
 	}
 
+	// The key of the infinite vertex shared by all tetras outside the convex hull,
+	// larger than the key of any point.
+	point_k infinite_vertex() const {
+		return inf_;
+	}
+
+	bool is_infinite(tetra_k t) const {
+		return infinite_index(t) != -1;
+	}
+
 private:
+	// Out-of-core triangulation, see streaming.h.
+	friend class stream_triangulator;
+	// Triangulation in the background, see async_triangulation.h.
+	friend class basic_async_triangulation<D, T>;
 
 	// *** POINT STUFF ***
 
-	// mutex struct, each point should have one mutex and one lock, lock aquires mutex
-	typedef std::mutex point_mutex;
+	typedef typename basic_point_store<T>::point_mutex point_mutex;
+
+	static point_k const NO_POINT = simplex_pool<D>::NO_POINT;
+
+	// Put point k first in the conflict list of t.
+	void push_point(tetra_k t, point_k k) {
+		points_.next(k) = pool_.first_point(t);
+		pool_.first_point(t) = k;
+	}
 
+	// Back to an empty triangulation, see reset().
+	void clear() {
+		pool_.clear();
+		points_.clear();
+		hull_hint_ = -1;
+		inserted_ = 0;
+		num_dead_ = 0;
+		num_processed_ = 0;
+		weighted_ = false;
+		sampled_ = 0;
+		down_.clear();
+		incident_.clear();
+		if (coarser_) coarser_->clear();
+	}
 
-	struct point_data {
-		xyz pos;
-		point_mutex p_mutex;	// Note that we don't need point_lock here
-		//std::unordered_set<tetra, tetra_hash> neighbor_tetras;	// Is it better to store only 3 points instead of the whole tetra?
+	// Insert the points added since the last run. An empty triangulation is seeded
+	// first, and stays empty while there are less than 4 points or they are coplanar.
+	// Otherwise each point is located by walking from the previous one, the first from
+	// the live tetra hint if given, and handed to the tetra whose region holds it.
+	// Then the tasks run.
+	void insert_pending(tetra_k hint = -1) {
+		point_k first = inserted_;
+		point_k last = points_.size();
+		if (first == last) return;
+		if (hierarchy_) {
+			insert_rounds(hint);
+			return;
+		}
+		std::vector<tetra_k> roots;
+		if (pool_.size() == 0) {
+			if (!seed(roots)) return;
+		} else {
+			locate_pending(first, last, hint != -1 ? hint : hull_hint_, roots);
+		}
+		inserted_ = last;
+		run_root_tasks(roots);
+	}
+
+	// Insert the points added since the last run in rounds, each as large as the
+	// triangulation but at most HIERARCHY_MAX_ROUND points. The sample of a round
+	// goes to the coarser level first, then the points of the round are located
+	// through the hierarchy and their tasks run.
+	void insert_rounds(tetra_k hint) {
+		point_k last = points_.size();
+		if (coarser_) incident_.resize(last, -1);
+		while (inserted_ < last && !cancelled()) {
+			point_k size = std::min<point_k>(std::max<point_k>(inserted_, HIERARCHY_MIN_ROUND), HIERARCHY_MAX_ROUND);
+			point_k end = std::min<point_k>(last, inserted_ + size);
+			if (coarser_) {
+				// the coarser levels only guide walks, they need no weights
+				std::vector<point_type> sample;
+				for (; sampled_ < end; ++sampled_) {
+					if (!in_coarser_level(sampled_)) continue;
+					sample.push_back(points_[sampled_]);
+					coarser_->down_.push_back(sampled_);
+				}
+				coarser_->insert(sample);
+			}
+			std::vector<tetra_k> roots;
+			if (pool_.size() == 0) {
+				// the points wait for a seed, keep the sample of the coarser level
+				if (!seed(roots, end)) return;
+			} else {
+				locate_pending(inserted_, end, hint != -1 ? hint : hull_hint_, roots);
+			}
+			inserted_ = end;
+			run_root_tasks(roots);
+			hint = -1;
+		}
+	}
+
+	// Seed with a finite tetra and the D + 1 infinite tetras glued to its faces, and hand
+	// the points before last to them. Return false if the points do not span a tetra.
+	bool seed(std::vector<tetra_k>& roots, point_k last = -1) {
+		point_k n = last != -1 ? last : point_k(points_.size());
+		tetra seed_tetra;
+		if (!get_initial_tetra(seed_tetra)) return false;
+		T* p[D + 1];
+		for (int k = 0; k <= D; ++k) p[k] = pos(seed_tetra[k]);
+		for (size_t i = 0; i < 3; ++i) {
+			REAL c = 0;
+			for (int k = 0; k <= D; ++k) c += REAL(p[k][i]) / (D + 1);
+			center_[i] = c;
+		}
+		if (dimension<D>::orient(p, p[D]) < 0) {
+			std::swap(seed_tetra[D - 1], seed_tetra[D]);
+		}
+
+		// Tetras are positively oriented. An infinite tetra is oriented as if the infinite
+		// vertex were a point far outside its hull face.
+		tetra_k seed = allocate_slots(D + 2);
+		pool_.vertices(seed) = seed_tetra;
+		for (int i = 0; i <= D; ++i) {
+			tetra t = seed_tetra;
+			t[i] = inf_;
+			std::swap(t[(i + 1) % (D + 1)], t[(i + 2) % (D + 1)]);
+			pool_.vertices(seed + 1 + i) = t;
+		}
+		// every pair of seed tetras shares a face
+		for (tetra_k a = seed; a < seed + D + 2; ++a) {
+			for (tetra_k b = seed; b < seed + D + 2; ++b) {
+				if (a == b) continue;
+				for (int i = 0; i <= D; ++i) {
+					for (int j = 0; j <= D; ++j) {
+						if (face_key(pool_.vertices(a), i) == face_key(pool_.vertices(b), j)) pool_.neighbors(a)[i] = b;
+					}
+				}
+			}
+		}
+		// Put each point in the conflict list of its seed tetra, in reverse so that the
+		// lists keep the order of the points
+		for (point_k i = n; i-- > 0;) {
+			if (std::find(seed_tetra.begin(), seed_tetra.end(), i) != seed_tetra.end()) continue;
+			tetra_k best = -1;
+			for (tetra_k t = seed; t < seed + D + 2; ++t) {
+				int res = in_region(t, i);
+				if (res > 0) {
+					best = t;
+					break;
+				}
+				if (res == 0 && best == -1) best = t;
+			}
+			if (best != -1) push_point(best, i);
+		}
+		hull_hint_ = seed + 1;
+		if (coarser_) {
+			for (auto&& v : seed_tetra) incident_[v] = seed;
+		}
+		for (tetra_k t = seed; t < seed + D + 2; ++t) {
+			if (pool_.first_point(t) != NO_POINT) roots.push_back(t);
+		}
+		// a seed vertex from a later round is counted when that round drops it
+		for (auto&& v : seed_tetra) {
+			if (v < n) ++num_processed_;
+		}
+		return true;
+	}
+
+	// Locate the points [first, last) in parallel, each block of points walking from
+	// start and then from the tetra of its previous point, or each point from the
+	// hierarchy if there is one, and add them to the points of their tetras. roots
+	// gets the tetras that had no point yet.
+	void locate_pending(point_k first, point_k last, tetra_k start, std::vector<tetra_k>& roots) {
+		std::vector<tetra_k> located(last - first);
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(tbb::blocked_range<point_k>(first, last, LOCATE_GRAIN), [&](tbb::blocked_range<point_k> const& r) {
+				unsigned seed = r.begin();
+				tetra_k hint = start;
+				for (point_k k = r.begin(); k < r.end(); ++k) {
+					if (coarser_) hint = hierarchy_start(pos(k), hint, seed);
+					tetra_k t = walk(hint, k, seed);
+					if (t == -1) t = scan(k);
+					located[k - first] = t;
+					if (t != -1) hint = t;
+				}
+			});
+		});
+		// in reverse, so that the lists keep the order of the points; the lists are
+		// empty between runs, so a tetra is a root once, where its first point is
+		for (point_k k = last; k-- > first;) {
+			tetra_k t = located[k - first];
+			if (t != -1) push_point(t, k);
+		}
+		for (point_k k = first; k < last; ++k) {
+			tetra_k t = located[k - first];
+			if (t != -1 && pool_.first_point(t) == k) roots.push_back(t);
+		}
+	}
+
+	// Walk from the live tetra hint to a tetra whose region holds q, each step crossing
+	// a face q is beyond. The first face tried changes from step to step, so the walk
+	// can't cycle for ever. Finalized tetras are never entered; return -1 if they block
+	// the way or the walk takes too long.
+	tetra_k walk(tetra_k hint, point_k q, unsigned& seed) const {
+		return walk(hint, pos(q), seed);
+	}
+	tetra_k walk(tetra_k hint, T* q, unsigned& seed) const {
+		tetra_k t = hint;
+		for (size_t steps = 0; steps < pool_.size(); ++steps) {
+			auto&& v = pool_.vertices(t);
+			auto&& nei = pool_.neighbors(t);
+			int i = infinite_index(t);
+			seed = seed * 1103515245u + 12345u;
+			int start = seed >> 16;
+			tetra_k next = -1;
+			bool blocked = false;
+			if (i == -1) {
+				for (int k = 0; k <= D && next == -1; ++k) {
+					int j = (start + k) % (D + 1);
+					if (face_orient(v, j, q) >= 0) continue;
+					if (nei[j] == FINAL_TETRA) blocked = true;
+					else next = nei[j];
+				}
+			} else {
+				T* o = const_cast<T*>(center_.data());
+				T* f[D];
+				for (int k = 0; k < D; ++k) f[k] = pos(v[facet(i, k)]);
+				if (dimension<D>::orient(f, q) < 0) {
+					// q is inside the hull
+					if (nei[i] == FINAL_TETRA) return -1;
+					next = nei[i];
+				} else {
+					// cross a side of the cone to the infinite tetra beyond it
+					for (int k = 0; k < D && next == -1; ++k) {
+						int j = (start + k) % D;
+						if (dimension<D>::cone_side(o, f, j, q) < 0) next = nei[facet(i, dimension<D>::cone_opposite(j))];
+					}
+				}
+			}
+			if (next == -1) return blocked ? -1 : t;
+			t = next;
+		}
+		return -1;
+	}
+
+	// Return the live tetra whose region holds q, preferring strict containment, by
+	// testing them all. Return -1 if there is none.
+	tetra_k scan(point_k q) const {
+		return scan(pos(q));
+	}
+	tetra_k scan(T* q) const {
+		tetra_k ret = -1;
+		for (size_t t = 0; t < pool_.size(); ++t) {
+			if (!is_alive(t)) continue;
+			int res = in_region(t, q);
+			if (res > 0) return t;
+			if (res == 0 && ret == -1) ret = t;
+		}
+		return ret;
+	}
+
+	// Return true iff q is at the same position as a point of t, in 2D at the same x and y.
+	bool on_vertex(tetra_k t, point_k q) const {
+		point_type const& p = points_[q];
+		for (auto&& v : pool_.vertices(t)) {
+			if (v != inf_ && std::equal(p.begin(), p.begin() + D, points_[v].begin())) return true;
+		}
+		return false;
+	}
+
+	// Points walked by one task when locating.
+	static size_t const LOCATE_GRAIN = 1 << 12;
+	// Tetras per cell of the grid seeding the walks of locate().
+	static size_t const LOCATE_CELL_TETRAS = 32;
+
+	// Cubic cells over the bounding box of the points, each with some live finite
+	// tetra whose centroid is in it, or -1.
+	struct locate_grid {
+		xyz origin;
+		// cells per unit length
+		REAL scale;
+		std::array<size_t, 3> dims;
+		std::vector<std::atomic<tetra_k> > cells;
+
+		// The cell of q, or the nearest cell if q is outside the box.
+		size_t cell(REAL const* q) const {
+			size_t ret = 0;
+			for (int a = 2; a >= 0; --a) {
+				REAL x = (q[a] - origin[a]) * scale;
+				ret = ret * dims[a] + (x <= 0 ? 0 : std::min(dims[a] - 1, size_t(x)));
+			}
+			return ret;
+		}
 	};
 
+	locate_grid make_locate_grid() const {
+		locate_grid grid;
+		xyz lo, hi;
+		bool empty = true;
+		for (size_t k = 0; k < points_.size(); ++k) {
+			if (points_.released(k >> point_store::PAGE_BITS)) continue;
+			for (int a = 0; a < 3; ++a) {
+				lo[a] = empty ? points_[k][a] : std::min(lo[a], points_[k][a]);
+				hi[a] = empty ? points_[k][a] : std::max(hi[a], points_[k][a]);
+			}
+			empty = false;
+		}
+		REAL extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+		REAL volume = 1;
+		for (int a = 0; a < 3; ++a) volume *= std::max(hi[a] - lo[a], extent * 1e-3);
+		size_t num_cells = std::max<size_t>(1, pool_.size() / LOCATE_CELL_TETRAS);
+		grid.origin = lo;
+		grid.scale = extent > 0 ? std::cbrt(num_cells / volume) : 1;
+		for (int a = 0; a < 3; ++a) {
+			grid.dims[a] = std::max<size_t>(1, size_t(std::ceil((hi[a] - lo[a]) * grid.scale)));
+		}
+		grid.cells = std::vector<std::atomic<tetra_k> >(grid.dims[0] * grid.dims[1] * grid.dims[2]);
+		for (auto&& c : grid.cells) c.store(-1, std::memory_order_relaxed);
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), pool_.size(), [&](size_t t) {
+				if (!is_alive(t) || is_infinite(t)) return;
+				point_type c = centroid(t);
+				grid.cells[grid.cell(c.data())].store(t, std::memory_order_relaxed);
+			});
+		});
+		return grid;
+	}
+
+	// *** HIERARCHY ***
+
+	// Points of a level per point of the level above.
+	static size_t const HIERARCHY_RATIO = 32;
+	// Fewest points a level is expected to have to get a coarser level.
+	static size_t const HIERARCHY_MIN_LEVEL = 1 << 12;
+	// Points of the first rounds, enough to keep the threads busy.
+	static point_k const HIERARCHY_MIN_ROUND = 1 << 12;
+
+	// Return true for about one point in HIERARCHY_RATIO, the same ones on every run.
+	static bool in_coarser_level(point_k k) {
+		uint32_t h = uint32_t(k) * 2654435761u;
+		h ^= h >> 16;
+		h *= 0x85ebca6bu;
+		h ^= h >> 13;
+		return h % HIERARCHY_RATIO == 0;
+	}
+
+	// Return the live tetra to walk to q from: locate q in the coarser level, and
+	// take a tetra around the nearest vertex of the tetra found that is a vertex
+	// here too. Return hint if there is none.
+	tetra_k hierarchy_start(T* q, tetra_k hint, unsigned& seed) const {
+		if (coarser_->pool_.size() == 0) return hint;
+		tetra_k t = coarser_->hierarchy_walk(q, seed);
+		if (t == -1) return hint;
+		REAL best = std::numeric_limits<REAL>::infinity();
+		for (auto&& v : coarser_->pool_.vertices(t)) {
+			if (v == inf_) continue;
+			tetra_k start = incident_[coarser_->down_[v]];
+			if (start == -1 || !is_alive(start)) continue;
+			point_type const& p = coarser_->points_[v];
+			REAL d = 0;
+			for (int a = 0; a < D; ++a) d += (REAL(p[a]) - q[a]) * (REAL(p[a]) - q[a]);
+			if (d < best) {
+				best = d;
+				hint = start;
+			}
+		}
+		return hint;
+	}
+
+	// Return the live tetra whose region holds q, walking down the hierarchy.
+	tetra_k hierarchy_walk(T* q, unsigned& seed) const {
+		tetra_k start = coarser_ ? hierarchy_start(q, hull_hint_, seed) : hull_hint_;
+		tetra_k t = walk(start, q, seed);
+		return t != -1 ? t : scan(q);
+	}
+
+	// *** REMOVAL ***
+
+	// Collect the live tetras around vertex v, walking to it from hint. Return false
+	// if v is not a vertex.
+	bool get_star(point_k v, tetra_k hint, std::vector<tetra_k>& star) const {
+		if (pool_.size() == 0 || size_t(v) >= size_t(inserted_)) return false;
+		if (hint < 0 || size_t(hint) >= pool_.size() || !is_alive(hint)) hint = hull_hint_;
+		unsigned seed = v;
+		auto&& hint_vs = pool_.vertices(hint);
+		tetra_k t = std::find(hint_vs.begin(), hint_vs.end(), v) != hint_vs.end() ? hint : walk(hint, v, seed);
+		if (t == -1) t = scan(v);
+		if (t == -1 || std::find(pool_.vertices(t).begin(), pool_.vertices(t).end(), v) == pool_.vertices(t).end()) return false;
+		// the tetras around v are connected through their faces containing v
+		star.push_back(t);
+		for (size_t k = 0; k < star.size(); ++k) {
+			auto&& vs = pool_.vertices(star[k]);
+			for (int i = 0; i < 4; ++i) {
+				tetra_k nei = pool_.neighbors(star[k])[i];
+				if (vs[i] == v || nei < 0 || std::find(star.begin(), star.end(), nei) != star.end()) continue;
+				star.push_back(nei);
+			}
+		}
+		return true;
+	}
+
+	// Return true iff v is off the hull and its star is positively oriented and locally
+	// Delaunay across all its faces, which are the only faces a move of v changes.
+	bool keeps_delaunay(point_k v, std::vector<tetra_k> const& star) const {
+		for (auto&& t : star) {
+			if (is_infinite(t)) return false;
+		}
+		for (auto&& t : star) {
+			auto&& vs = pool_.vertices(t);
+			if (face_orient(vs, D, pos(vs[D])) <= 0) return false;
+			for (int i = 0; i < 4; ++i) {
+				tetra_k nei = pool_.neighbors(t)[i];
+				// a face inside the star is tested from its tetra of smaller key
+				if (nei < 0 || (nei < t && vs[i] != v)) continue;
+				auto&& back = pool_.neighbors(nei);
+				point_k w = pool_.vertices(nei)[std::find(back.begin(), back.end(), t) - back.begin()];
+				// beyond a hull face, the orientation of t is the test
+				if (w != inf_ && in_conflict(t, w)) return false;
+			}
+		}
+		return true;
+	}
+
+	// Replace the star of v with the tetras of the Delaunay triangulation of its link
+	// that lie inside it. Those tetras are found from the faces of the link, which the
+	// triangulation of the link contains, and across the faces that are not in the link.
+	// Return false, changing nothing, if the link triangulation misses a link face.
+	bool fill_star(point_k v, std::vector<tetra_k> const& star) {
+		// the finite points of the link, local key k is link[k]
+		std::vector<point_k> link;
+		bool on_hull = false;
+		for (auto&& t : star) {
+			for (auto&& w : pool_.vertices(t)) {
+				if (w == inf_) on_hull = true;
+				else if (w != v && std::find(link.begin(), link.end(), w) == link.end()) link.push_back(w);
+			}
+		}
+		std::vector<point_type> link_xyzs;
+		std::vector<REAL> link_weights;
+		for (auto&& w : link) {
+			link_xyzs.push_back(points_[w]);
+			if (weighted_) link_weights.push_back(points_.weight(w));
+		}
+		basic_triangulator local(1, link.size(), CONFLICT_LISTS);
+		local.weighted_ = weighted_;
+		local.points_.assign(span<point_type const>(link_xyzs.data(), link_xyzs.size()), span<REAL const>(link_weights.data(), link_weights.size()));
+		local.insert_pending();
+		if (local.pool_.size() == 0) return false;
+		auto to_local = [&](point_k w) {
+			return w == inf_ ? local.inf_ : point_k(std::find(link.begin(), link.end(), w) - link.begin());
+		};
+		auto to_global = [&](point_k w) {
+			return w == local.inf_ ? inf_ : link[w];
+		};
+
+		// faces of the local tetras, oriented with their tetra on the positive side
+		std::vector<std::pair<triangle, std::pair<tetra_k, int> > > faces;
+		for (size_t t = 0; t < local.pool_.size(); ++t) {
+			if (!local.is_alive(t)) continue;
+			for (int i = 0; i < 4; ++i) {
+				faces.push_back(std::make_pair(oriented_face(local.pool_.vertices(t), i), std::make_pair(tetra_k(t), i)));
+			}
+		}
+		std::sort(faces.begin(), faces.end());
+		// the local tetra on the side of v of each link face, glued to the tetra beyond
+		std::vector<tetra_k> fill;
+		std::vector<std::pair<std::pair<tetra_k, int>, tetra_k> > glue;
+		for (auto&& t : star) {
+			auto&& vs = pool_.vertices(t);
+			int iv = std::find(vs.begin(), vs.end(), v) - vs.begin();
+			tetra f;
+			for (int k = 0; k < 4; ++k) f[k] = to_local(vs[k]);
+			triangle key = oriented_face(f, iv);
+			auto it = std::lower_bound(faces.begin(), faces.end(), std::make_pair(key, std::make_pair(tetra_k(-1), -1)));
+			if (it == faces.end() || it->first != key) return false;
+			glue.push_back(std::make_pair(it->second, t));
+			if (std::find(fill.begin(), fill.end(), it->second.first) == fill.end()) fill.push_back(it->second.first);
+		}
+		std::sort(glue.begin(), glue.end());
+		auto glued = [&](tetra_k lt, int i) {
+			auto it = std::lower_bound(glue.begin(), glue.end(), std::make_pair(std::make_pair(lt, i), tetra_k(-1)));
+			return it != glue.end() && it->first == std::make_pair(lt, i) ? it->second : -1;
+		};
+		for (size_t k = 0; k < fill.size(); ++k) {
+			if (!on_hull && local.is_infinite(fill[k])) return false;
+			for (int i = 0; i < 4; ++i) {
+				tetra_k nei = local.pool_.neighbors(fill[k])[i];
+				if (glued(fill[k], i) != -1 || std::find(fill.begin(), fill.end(), nei) != fill.end()) continue;
+				fill.push_back(nei);
+			}
+		}
+
+		// center_ must stay inside the hull, which shrinks if v was on it
+		bool move_center = false;
+		for (auto&& t : star) {
+			if (on_hull && !is_infinite(t) && contains_center(t)) move_center = true;
+		}
+		// the new tetras take the slots of the star, then fresh ones; the slots of the
+		// star left over die
+		std::vector<tetra_k> slots(star.begin(), star.begin() + std::min(star.size(), fill.size()));
+		tetra_k first = allocate_slots(fill.size() > star.size() ? fill.size() - star.size() : 0);
+		for (size_t k = star.size(); k < fill.size(); ++k) slots.push_back(first + tetra_k(k - star.size()));
+		// read the star before writing over it: the new tetras, and for each face of the
+		// link the tetra beyond, the index of the star there and the new tetra inside
+		std::vector<tetra> fill_vertices(fill.size());
+		std::vector<tetra_neighbors> fill_neighbors(fill.size());
+		std::vector<std::pair<std::pair<tetra_k, int>, tetra_k> > beyond;
+		for (size_t k = 0; k < fill.size(); ++k) {
+			for (int i = 0; i < 4; ++i) {
+				fill_vertices[k][i] = to_global(local.pool_.vertices(fill[k])[i]);
+				tetra_k old_tetra = glued(fill[k], i);
+				if (old_tetra == -1) {
+					tetra_k nei = local.pool_.neighbors(fill[k])[i];
+					fill_neighbors[k][i] = slots[std::find(fill.begin(), fill.end(), nei) - fill.begin()];
+					continue;
+				}
+				auto&& old_vs = pool_.vertices(old_tetra);
+				tetra_k nei = pool_.neighbors(old_tetra)[std::find(old_vs.begin(), old_vs.end(), v) - old_vs.begin()];
+				fill_neighbors[k][i] = nei;
+				if (nei < 0) continue;
+				auto&& nei_nei = pool_.neighbors(nei);
+				beyond.push_back(std::make_pair(std::make_pair(nei, int(std::find(nei_nei.begin(), nei_nei.end(), old_tetra) - nei_nei.begin())), slots[k]));
+			}
+		}
+		for (size_t k = fill.size(); k < star.size(); ++k) pool_.kill(star[k]);
+		if (star.size() > fill.size()) num_dead_ += star.size() - fill.size();
+		for (size_t k = 0; k < fill.size(); ++k) {
+			pool_.vertices(slots[k]) = fill_vertices[k];
+			pool_.neighbors(slots[k]) = fill_neighbors[k];
+			pool_.first_point(slots[k]) = NO_POINT;
+		}
+		for (auto&& b : beyond) pool_.neighbors(b.first.first)[b.first.second] = b.second;
+		if (coarser_) {
+			incident_[v] = -1;
+			for (auto&& t : slots) {
+				for (auto&& w : pool_.vertices(t)) {
+					if (w != inf_) incident_[w] = t;
+				}
+			}
+		}
+		for (auto&& t : slots) {
+			if (is_infinite(t)) hull_hint_ = t;
+			else if (move_center) {
+				center_ = centroid(t);
+				move_center = false;
+			}
+		}
+		if (move_center) {
+			for (size_t t = 0; t < pool_.size() && move_center; ++t) {
+				if (is_alive(t) && !is_infinite(t)) {
+					center_ = centroid(t);
+					move_center = false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Insert point v again after moving it, locating it from the live tetra hint.
+	void reinsert(point_k v, tetra_k hint) {
+		unsigned seed = v;
+		tetra_k t = walk(hint, v, seed);
+		if (t == -1) t = scan(v);
+		if (t == -1) return;
+		push_point(t, v);
+		// one point is not worth starting threads for
+		run_root_tasks(std::vector<tetra_k>(1, t), 1);
+	}
+
+	// *** REFINEMENT ***
+
+	// A tetra too bad to keep, and the live tetra its circumcenter is in.
+	struct refinement {
+		REAL ratio;
+		xyz center;
+		tetra_k source;
+		tetra_k tetra;
+	};
+
+	// Return true iff q is a circumcenter of the current refine() round whose tetra was
+	// replaced by an earlier insertion, which may have left it good.
+	bool is_obsolete(point_k q) const {
+		if (q < refine_first_) return false;
+		auto&& source = refine_sources_[q - refine_first_];
+		return !is_alive(source.first) || pool_.load_vertices(source.first) != source.second;
+	}
+
+	// Tetras refined by one task when looking for bad ones.
+	static size_t const REFINE_GRAIN = 1 << 12;
+
+	// Return the finite tetras whose radius-edge ratio is more than max_ratio and whose
+	// circumcenter is inside the hull, the worst one for each tetra holding a
+	// circumcenter, worst first.
+	std::vector<refinement> find_bad_tetras(REAL max_ratio) const {
+		size_t size = pool_.size();
+		size_t num_blocks = (size + REFINE_GRAIN - 1) / REFINE_GRAIN;
+		std::vector<std::vector<refinement> > block_bad(num_blocks);
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+				unsigned seed = b;
+				for (size_t t = b * REFINE_GRAIN; t < std::min(size, (b + 1) * REFINE_GRAIN); ++t) {
+					if (!is_alive(t) || is_infinite(t)) continue;
+					refinement r;
+					r.source = t;
+					REAL radius;
+					circumsphere(t, r.center, radius);
+					if (radius == std::numeric_limits<REAL>::infinity()) continue;
+					auto&& v = pool_.vertices(t);
+					REAL shortest = std::numeric_limits<REAL>::infinity();
+					for (int i = 0; i < 4; ++i) {
+						for (int j = i + 1; j < 4; ++j) {
+							xyz const& p = points_[v[i]];
+							xyz const& q = points_[v[j]];
+							shortest = std::min(shortest, (p[0] - q[0]) * (p[0] - q[0]) + (p[1] - q[1]) * (p[1] - q[1]) + (p[2] - q[2]) * (p[2] - q[2]));
+						}
+					}
+					r.ratio = radius / std::sqrt(shortest);
+					if (!(r.ratio > max_ratio)) continue;
+					r.tetra = walk(t, r.center.data(), seed);
+					if (r.tetra == -1 || is_infinite(r.tetra)) continue;
+					block_bad[b].push_back(r);
+				}
+			});
+		});
+		std::vector<refinement> ret;
+		for (auto&& b : block_bad) ret.insert(ret.end(), b.begin(), b.end());
+		// a tetra holds the circumcenter of at most one bad tetra per round
+		std::sort(ret.begin(), ret.end(), [](refinement const& a, refinement const& b) {
+			return a.tetra != b.tetra ? a.tetra < b.tetra : a.ratio > b.ratio;
+		});
+		ret.erase(std::unique(ret.begin(), ret.end(), [](refinement const& a, refinement const& b) {
+			return a.tetra == b.tetra;
+		}), ret.end());
+		std::sort(ret.begin(), ret.end(), [](refinement const& a, refinement const& b) {
+			return a.ratio > b.ratio;
+		});
+		return ret;
+	}
+
+	// *** SLIVERS ***
+
+	// Random moves a vertex of a sliver tries, and the longest as a part of its shortest edge.
+	static int const PERTURB_TRIES = 16;
+	static constexpr REAL PERTURB_STEP = 0.2;
+	// Vertices moved by one task.
+	static size_t const PERTURB_GRAIN = 64;
+
+	// Each vertex of a sliver once, with a live tetra around it.
+	std::vector<std::pair<point_k, tetra_k> > sliver_vertices(REAL sliver_angle) const {
+		size_t size = pool_.size();
+		size_t num_blocks = (size + COMPACT_GRAIN - 1) / COMPACT_GRAIN;
+		std::vector<std::vector<std::pair<point_k, tetra_k> > > blocks(num_blocks);
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+				for (size_t t = b * COMPACT_GRAIN; t < std::min(size, (b + 1) * COMPACT_GRAIN); ++t) {
+					if (!is_alive(t) || is_infinite(t)) continue;
+					auto&& v = pool_.vertices(t);
+					if (min_dihedral_angle(points_[v[0]], points_[v[1]], points_[v[2]], points_[v[3]]) >= sliver_angle) continue;
+					for (auto&& w : v) blocks[b].push_back(std::make_pair(w, tetra_k(t)));
+				}
+			});
+		});
+		std::vector<std::pair<point_k, tetra_k> > ret;
+		for (auto&& b : blocks) ret.insert(ret.end(), b.begin(), b.end());
+		std::sort(ret.begin(), ret.end());
+		ret.erase(std::unique(ret.begin(), ret.end(), [](std::pair<point_k, tetra_k> const& a, std::pair<point_k, tetra_k> const& b) {
+			return a.first == b.first;
+		}), ret.end());
+		return ret;
+	}
+
+	// Move vertex v, found from the live tetra hint around it, see perturb_slivers().
+	// The tetras are not changed, only the positions of v and its neighbors are read
+	// under their locks. Return 1 if v moved, 0 if no move was better and -1 if some
+	// neighbor is locked by another vertex.
+	int perturb_vertex(point_k v, tetra_k hint, unsigned& seed) {
+		std::vector<tetra_k> star;
+		if (!get_star(v, hint, star)) return 0;
+		for (auto&& t : star) {
+			if (is_infinite(t)) return 0;
+		}
+		std::vector<point_mutex*> locked;
+		for (auto&& t : star) {
+			for (auto&& w : pool_.vertices(t)) {
+				point_mutex* m = &points_.lock(w);
+				if (std::find(locked.begin(), locked.end(), m) != locked.end()) continue;
+				if (!m->try_lock()) {
+					for (auto&& l : locked) l->unlock();
+					return -1;
+				}
+				locked.push_back(m);
+			}
+		}
+		// the smallest dihedral angle of the star and the tetra that has it
+		auto worst = [&](tetra_k* which) {
+			REAL ret = std::numeric_limits<REAL>::infinity();
+			for (auto&& t : star) {
+				auto&& vs = pool_.vertices(t);
+				REAL angle = min_dihedral_angle(points_[vs[0]], points_[vs[1]], points_[vs[2]], points_[vs[3]]);
+				if (angle < ret) {
+					ret = angle;
+					if (which) *which = t;
+				}
+			}
+			return ret;
+		};
+		tetra_k sliver = star[0];
+		REAL best_angle = worst(&sliver);
+		xyz const old = points_[v];
+		xyz best = old;
+		// unit normal of the face of the sliver across v, towards v
+		auto&& sv = pool_.vertices(sliver);
+		int iv = std::find(sv.begin(), sv.end(), v) - sv.begin();
+		xyz const& a = points_[sv[facet(iv, 0)]];
+		xyz const& b = points_[sv[facet(iv, 1)]];
+		xyz const& c = points_[sv[facet(iv, 2)]];
+		xyz u = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+		xyz w = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+		xyz normal = {u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0]};
+		REAL len = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (normal[0] * (old[0] - a[0]) + normal[1] * (old[1] - a[1]) + normal[2] * (old[2] - a[2]) < 0) len = -len;
+		for (auto&& x : normal) x = len != 0 ? x / len : 0;
+		REAL shortest = std::numeric_limits<REAL>::infinity();
+		for (auto&& t : star) {
+			for (auto&& k : pool_.vertices(t)) {
+				xyz const& p = points_[k];
+				if (k != v) shortest = std::min(shortest, (p[0] - old[0]) * (p[0] - old[0]) + (p[1] - old[1]) * (p[1] - old[1]) + (p[2] - old[2]) * (p[2] - old[2]));
+			}
+		}
+		shortest = std::sqrt(shortest);
+		for (int k = 0; k < PERTURB_TRIES; ++k) {
+			// a random direction in the half space off the face, and a growing step
+			xyz d;
+			REAL d_len = 0;
+			for (auto&& x : d) {
+				seed = seed * 1103515245u + 12345u;
+				x = ((seed >> 16) & 0x7fff) / REAL(0x4000) - 1;
+			}
+			for (int j = 0; j < 3; ++j) {
+				d[j] += normal[j];
+				d_len += d[j] * d[j];
+			}
+			if (d_len == 0) continue;
+			REAL step = PERTURB_STEP * shortest * (k + 1) / PERTURB_TRIES / std::sqrt(d_len);
+			xyz p = {old[0] + step * d[0], old[1] + step * d[1], old[2] + step * d[2]};
+			points_.set(v, p);
+			if (!keeps_delaunay(v, star)) continue;
+			REAL angle = worst(nullptr);
+			if (angle > best_angle) {
+				best_angle = angle;
+				best = p;
+			}
+		}
+		points_.set(v, best);
+		for (auto&& l : locked) l->unlock();
+		return best != old ? 1 : 0;
+	}
+
+	// Return true iff center_ is in the finite tetra t or on its boundary.
+	bool contains_center(tetra_k t) const {
+		auto&& v = pool_.vertices(t);
+		T* o = const_cast<T*>(center_.data());
+		for (int j = 0; j <= D; ++j) {
+			if (face_orient(v, j, o) < 0) return false;
+		}
+		return true;
+	}
+
+	point_type centroid(tetra_k t) const {
+		xyz ret = {0, 0, 0};
+		for (auto&& v : pool_.vertices(t)) {
+			for (int a = 0; a < 3; ++a) ret[a] += REAL(points_[v][a]) / (D + 1);
+		}
+		return point_type{{T(ret[0]), T(ret[1]), T(ret[2])}};
+	}
+
+	// Position of a point for spatial_sort_order(), which sorts doubles in 3D: a 2D
+	// point is sorted by its x and y only.
+	static xyz sort_position(point_type const& p) {
+		return xyz{{REAL(p[0]), REAL(p[1]), D == 3 ? REAL(p[2]) : 0}};
+	}
 
 	// *** TETRA STUFF ***
 
-	// tetra_data which is the list of points inside a tetrahedron, used as data of hashmap 
-	//typedef std::vector<point_k> tetra_data;
-	typedef struct {
-            std::vector<point_k> pts_intetra;    
-            // four neighbors of this tetra, set to the vertex index to -1 if this neighbor is null
-            tetra neighbor[4];
-        } tetra_data;
+	// facet(i, j) is the index of point j of the face opposite point i of a tetra.
+	// The face is ordered so that point i is on its positive side, which is outside
+	// for the hull face of an infinite tetra.
+	static int facet(int i, int j) {
+		return dimension<D>::facet(i, j);
+	}
+
+	// Slots renumbered by one task when compacting.
+	static size_t const COMPACT_GRAIN = 1 << 14;
+
+	// Neighbor of a live tetra across a face whose other tetra was finalized: written
+	// out and dropped, since no point added later can be in conflict with it.
+	enum { FINAL_TETRA = -2 };
 
+	// Return the index of the infinite vertex in t, -1 if t is finite.
+	int infinite_index(tetra_k t) const {
+		auto&& v = pool_.vertices(t);
+		for (int i = 0; i <= D; ++i) {
+			if (v[i] == inf_) return i;
+		}
+		return -1;
+	}
 
-	// A concurrent hash table that maps tetra to tetra_data.
-	typedef tbb::concurrent_hash_map<tetra, std::shared_ptr<tetra_data>, tetra_hash> tetra_map;
+	// Return face i of t rotated to start with its smallest key, keeping its orientation.
+	static face oriented_face(tetra const& t, int i) {
+		face ret;
+		for (int j = 0; j < D; ++j) ret[j] = t[facet(i, j)];
+		std::rotate(ret.begin(), std::min_element(ret.begin(), ret.end()), ret.end());
+		return ret;
+	}
 
-	// *** TBB TASK ***
+	// Return the sorted keys of face i of t, to match faces of different tetras.
+	static face face_key(tetra const& t, int i) {
+		face ret;
+		for (int j = 0; j < D; ++j) ret[j] = t[facet(i, j)];
+		std::sort(ret.begin(), ret.end());
+		return ret;
+	}
 
-//	tbb::empty_task* root_task_;
+	// *** TASKS ***
 
 	job_queue job_queue_;
+	int num_thread_;
+
+	// Run the tasks of roots and the tasks they create, on num_thread threads or all of them.
+	void run_root_tasks(std::vector<tetra_k> const& roots, int num_thread = 0) {
+		if (rounds_) {
+			run_rounds(roots);
+			return;
+		}
+		for (auto&& t : roots) {
+			job_queue_.push_job(triangulation_job{this, t});
+		}
+		run_jobs(num_thread);
+		STATS(collect_stats());
+	}
+
+	// Run the queued tasks on num_thread threads or all of them. A task finding the
+	// tetra pool full stops the queue, the pool grows here, and the tasks go on.
+	void run_jobs(int num_thread = 0) {
+		job_queue_.run_jobs(num_thread);
+		while (pool_full_.load()) {
+			pool_full_.store(false);
+			grow_pool(0);
+			job_queue_.resume();
+			job_queue_.run_jobs(num_thread);
+		}
+	}
+
+	// Return the first of num new slots, growing the pool if it is full. Not while
+	// tasks run.
+	tetra_k allocate_slots(size_t num) {
+		tetra_k first = pool_.allocate(num);
+		if (first != -1) return first;
+		grow_pool(num);
+		return pool_.allocate(num);
+	}
+
+	// Double the slots reserved for the tetras, and more if num more slots would not
+	// fit. If that fails the queued tasks are dropped, leaving the points they hold out
+	// of the triangulation, and std::bad_alloc is thrown to the caller. Not while
+	// tasks run.
+	void grow_pool(size_t num) {
+		try {
+			pool_.grow(std::max(2 * pool_.max_size(), pool_.size() + num));
+		} catch (...) {
+			job_queue_.clear();
+			throw;
+		}
+	}
+
+	void create_new_task(tetra_k t) {
+		job_queue_.push_job(triangulation_job{this, t});
+	}
+
+	// Priority of point k in a round, a bijection of the keys. Spatially sorted keys
+	// would rank the points along the sort, so that of a row of touching cavities only
+	// the first would be inserted; the mix scatters the ranks.
+	static uint32_t round_priority(point_k k) {
+		uint32_t x = uint32_t(k) * 0x9e3779b1u;
+		x ^= x >> 16;
+		x *= 0x85ebca6bu;
+		x ^= x >> 13;
+		return x;
+	}
+
+	// Insert the points of the roots, and of the tetras they lead to, in rounds, see
+	// insertion_mode. The candidates of a round are the first points of the tetras
+	// holding points. Each finds its cavity and claims it with the tetras around it,
+	// whose neighbors change; the point of smallest round_priority() claiming a tetra
+	// owns it, and a point owning all it claimed wins. The others claim again, unless
+	// they claimed a tetra of a winner, until each candidate won or lost: the winners
+	// are those of inserting the candidates one at a time by priority, and are
+	// inserted in parallel, each in slots numbered by the order of the candidates.
+	// So the rounds do not depend on the threads.
+	void run_rounds(std::vector<tetra_k> const& roots) {
+		std::vector<tetra_k> active(roots);
+		std::vector<triangulation_task> tasks;
+		// what happened to each candidate: dropped, still claiming, lost to a winner, won
+		enum { DROPPED, OPEN, LOST, WON };
+		std::vector<char> states;
+		std::vector<tetra_k> offsets;
+		tbb::task_arena arena(num_thread_);
+		while (!active.empty() && !cancelled()) {
+			// a claim per slot, the slots of the new tetras of the last round too
+			if (owners_.size() < pool_.size()) {
+				std::vector<std::atomic<uint32_t> >(2 * pool_.size()).swap(owners_);
+				for (auto&& o : owners_) o.store(NO_OWNER, std::memory_order_relaxed);
+			}
+			std::atomic<uint32_t>* owners = owners_.data();
+			size_t num = active.size();
+			tasks.resize(num, triangulation_task(this, -1));
+			states.assign(num, DROPPED);
+			arena.execute([&] {
+				tbb::parallel_for(size_t(0), num, [&](size_t i) {
+					tasks[i].reset(active[i]);
+					if (tasks[i].find_claims()) states[i] = OPEN;
+				});
+				while (std::find(states.begin(), states.end(), OPEN) != states.end()) {
+					tbb::parallel_for(size_t(0), num, [&](size_t i) {
+						if (states[i] == OPEN) tasks[i].claim(owners);
+					});
+					tbb::parallel_for(size_t(0), num, [&](size_t i) {
+						if (states[i] == OPEN && tasks[i].owns_claims(owners)) states[i] = WON;
+					});
+					// the winners keep their claims
+					tbb::parallel_for(size_t(0), num, [&](size_t i) {
+						if (states[i] == OPEN) tasks[i].release_claims(owners);
+					});
+					tbb::parallel_for(size_t(0), num, [&](size_t i) {
+						if (states[i] == OPEN && tasks[i].meets_winner(owners)) states[i] = LOST;
+					});
+				}
+			});
+			offsets.assign(num + 1, 0);
+			for (size_t i = 0; i < num; ++i) {
+				offsets[i + 1] = offsets[i] + (states[i] == WON ? tasks[i].num_new_slots() : 0);
+			}
+			tetra_k first = allocate_slots(offsets[num]);
+			arena.execute([&] {
+				tbb::parallel_for(size_t(0), num, [&](size_t i) {
+					if (states[i] != WON) return;
+					tasks[i].replace_cavity(first + offsets[i]);
+					tasks[i].release_claims(owners);
+				});
+			});
+			// the winners share the points of their cavity faces, point them at their new
+			// tetras one winner at a time
+			if (coarser_) {
+				for (size_t i = 0; i < num; ++i) {
+					if (states[i] == WON) tasks[i].update_incident();
+				}
+			}
+			STATS(stats_.tasks += num);
+			// the losers and the new tetras holding points try again; a loser's tetra may
+			// be the slot of a new tetra now, keep it once
+			std::vector<tetra_k> next;
+			for (size_t i = 0; i < num; ++i) {
+				STATS(if (states[i] == LOST) ++stats_.retries);
+				num_processed_.fetch_add(tasks[i].take_processed(), std::memory_order_relaxed);
+				if (states[i] == WON) {
+					next.insert(next.end(), tasks[i].pending().begin(), tasks[i].pending().end());
+				} else if (is_alive(active[i]) && pool_.first_point(active[i]) != NO_POINT) {
+					next.push_back(active[i]);
+				}
+			}
+			std::sort(next.begin(), next.end());
+			next.erase(std::unique(next.begin(), next.end()), next.end());
+			active.swap(next);
+		}
+		STATS(collect_stats());
+	}
+
+	triangulation_stats stats_;
+#ifdef TRIANGULATOR_STATS
+	// Each worker counts in its own stats, a cache line away from the others.
+	struct worker_stats {
+		triangulation_stats stats;
+		char pad[64];
+	};
+	std::vector<worker_stats> worker_stats_;
 
-	void run_root_task(tetra t) {
-		job_queue_.push_job(triangulation_task(this, t));
-		job_queue_.run_jobs();
+	// The stats of the worker running the calling task.
+	triangulation_stats& local_stats() {
+		int worker = job_queue::current_worker();
+		// a thread of a task arena while inserting in rounds
+		if (worker < 0) worker = tbb::this_task_arena::current_thread_index();
+		return worker_stats_[worker].stats;
 	}
 
-	void create_new_task(tetra t) {
-		job_queue_.push_job(triangulation_task(this, t));
+	// Add the stats of the workers and their wait for the queue to stats_.
+	void collect_stats() {
+		for (auto&& w : worker_stats_) {
+			stats_ += w.stats;
+			w.stats.clear();
+		}
+		stats_.queue_wait_cycles += job_queue_.take_wait_cycles();
 	}
+#endif
 
+	// Insert the first point of a tetra: lock every tetra in conflict with the point,
+	// replace them with the star of the point, and hand their points to the new tetras.
 	class triangulation_task {
 	public:
-		triangulation_task(triangulator* thiz, tetra t) : 
-			thiz_(thiz), tetra_(t)
+		triangulation_task(basic_triangulator* thiz, tetra_k t) :
+			thiz_(thiz), tetra_(t), processed_(0)
 		{
 		}
 		void operator()() {
+#ifdef TRIANGULATOR_STATS
+			auto&& stats = thiz_->local_stats();
+			uint64_t start = stats_clock();
+			unsigned long long orient3d_calls = predicate_orient3d_calls;
+			unsigned long long orient3d_failures = predicate_orient3d_filter_failures;
+			unsigned long long insphere_calls = predicate_insphere_calls;
+			unsigned long long insphere_failures = predicate_insphere_filter_failures;
+			run();
+			++stats.tasks;
+			stats.task_cycles += stats_clock() - start;
+			stats.orient3d_calls += predicate_orient3d_calls - orient3d_calls;
+			stats.orient3d_filter_failures += predicate_orient3d_filter_failures - orient3d_failures;
+			stats.insphere_calls += predicate_insphere_calls - insphere_calls;
+			stats.insphere_filter_failures += predicate_insphere_filter_failures - insphere_failures;
+#else
+			run();
+#endif
+		}
+
+		// Start over with tetra t, for a round (see run_rounds()) or a job (see triangulation_job).
+		void reset(tetra_k t) {
+			tetra_ = t;
+			pending_.clear();
+		}
+		// Drop the first point of tetra_, or find its cavity without locking, and the
+		// tetras to claim for it: the cavity and the tetras across its faces, whose
+		// neighbors change. Return false if the point was dropped.
+		bool find_claims() {
+			if (drop_needless_point()) return false;
+			point_k pt = thiz_->pool_.first_point(tetra_);
+			priority_ = round_priority(pt);
+			get_local_tetras(pt, false);
+			claimed_ = local_tetras_;
+			for (auto&& b : boundary_) {
+				tetra_k t = thiz_->pool_.neighbors(b.first)[b.second];
+				if (t != FINAL_TETRA) claimed_.push_back(t);
+			}
+			return true;
+		}
+		// Claim the tetras, each keeps the smallest priority claiming it.
+		void claim(std::atomic<uint32_t>* owners) const {
+			for (auto&& t : claimed_) {
+				uint32_t owner = owners[t].load(std::memory_order_relaxed);
+				while (priority_ < owner && !owners[t].compare_exchange_weak(owner, priority_, std::memory_order_relaxed)) {
+				}
+			}
+		}
+		bool owns_claims(std::atomic<uint32_t> const* owners) const {
+			for (auto&& t : claimed_) {
+				if (owners[t].load(std::memory_order_relaxed) != priority_) return false;
+			}
+			return true;
+		}
+		// Give back the claimed tetras this point owns.
+		void release_claims(std::atomic<uint32_t>* owners) const {
+			for (auto&& t : claimed_) {
+				uint32_t owner = priority_;
+				owners[t].compare_exchange_strong(owner, NO_OWNER, std::memory_order_relaxed);
+			}
+		}
+		// Whether a winner owns a claimed tetra, once the other candidates released theirs.
+		bool meets_winner(std::atomic<uint32_t> const* owners) const {
+			for (auto&& t : claimed_) {
+				if (owners[t].load(std::memory_order_relaxed) != NO_OWNER) return true;
+			}
+			return false;
+		}
+		// Point the vertices of the new tetras at them, see incident_, after replace_cavity().
+		void update_incident() const {
+			for (auto&& t : slots_) {
+				for (auto&& v : thiz_->pool_.vertices(t)) {
+					if (v != thiz_->inf_) thiz_->incident_[v] = t;
+				}
+			}
+		}
+		// Slots the new tetras take beyond those of the cavity, see replace_cavity().
+		size_t num_new_slots() const {
+			return boundary_.size() > local_tetras_.size() ? boundary_.size() - local_tetras_.size() : 0;
+		}
+		std::vector<tetra_k> const& pending() const {
+			return pending_;
+		}
+		// Points inserted or dropped since the last call.
+		size_t take_processed() {
+			size_t ret = processed_;
+			processed_ = 0;
+			return ret;
+		}
+	private:
+		void run() {
 			// lock the points
-                    if (!try_lock_tetra_points()) {
-			thiz_->create_new_task(tetra_);
-			lock_fail();
-			return;
-		    }
-			// get tetra's points
-		    tetra_map::accessor ac;
-		    if (!thiz_->tetra_to_points_.find(ac, tetra_)) {
-			unlock_tetra_points();
-			return;
-		    }
-		    // triangulate
-		    auto tdata = ac->second;
-                    ac.release();
-		    triangulate_parallel(tdata->pts_intetra);
-                    unlock_tetra_points();
-		    return;
+			if (!try_lock_tetra_points()) {
+				thiz_->create_new_task(tetra_);
+				STATS(++thiz_->local_stats().retries);
+				lock_fail();
+				return;
+			}
+			// the tetra was replaced since the task was created, and its slot may hold
+			// another tetra now, with or without points
+			if (!thiz_->is_alive(tetra_) || thiz_->pool_.load_vertices(tetra_) != locked_ ||
+				thiz_->pool_.load_first_point(tetra_) == NO_POINT) {
+				STATS(++thiz_->local_stats().stale_tasks);
+				unlock_points();
+				return;
+			}
+			// The points of the new tetras are locked by this task, so it goes on with
+			// them while it has locked its last new point too, up to TASK_BATCH_POINTS
+			// points, saving a task and the locking of its tetra per point.
+			for (int n = 1; insert_first_point() && n < TASK_BATCH_POINTS && next_pending(); ++n) {
+			}
+			unlock_points();
+			thiz_->num_processed_.fetch_add(take_processed(), std::memory_order_relaxed);
+			for (auto&& t : pending_) {
+				if (thiz_->is_alive(t) && thiz_->pool_.load_first_point(t) != NO_POINT) thiz_->create_new_task(t);
+			}
+			pending_.clear();
+		}
+		// Insert or drop the first point of tetra_, and add the tetras left holding
+		// points to pending_. Return false if the point is not inserted since another
+		// task locks its cavity, or if its lock could not be taken after inserting it.
+		bool insert_first_point() {
+			point_k pt = thiz_->pool_.first_point(tetra_);
+			if (drop_needless_point()) return true;
+			if (!triangulate_parallel()) return false;
+			// another task may hold the new point for a moment, on its way to failing
+			// to lock a point of a new tetra
+			auto&& m = thiz_->points_.lock(pt);
+			if (!m.try_lock()) return false;
+			mutexs_.push_back(&m);
+			return true;
+		}
+		// Drop the first point of tetra_ if it is not to be inserted. Return true if it
+		// was dropped.
+		bool drop_needless_point() {
+			// a point on a vertex of the tetra is a duplicate, drop it
+			point_k pt = thiz_->pool_.first_point(tetra_);
+			if (!thiz_->weighted_ && thiz_->on_vertex(tetra_, pt)) {
+				STATS(++thiz_->local_stats().duplicates);
+				drop_first_point();
+				return true;
+			}
+			// a circumcenter no longer needed, drop it
+			if (thiz_->is_obsolete(pt)) {
+				STATS(++thiz_->local_stats().obsolete);
+				drop_first_point();
+				return true;
+			}
+			// a weighted point not in conflict with the tetra holding it is hidden, and
+			// so is one on a vertex at most as heavy, drop it
+			if (thiz_->weighted_ && !thiz_->in_conflict(tetra_, pt)) {
+				STATS(++thiz_->local_stats().hidden);
+				drop_first_point();
+				return true;
+			}
+			return false;
+		}
+		// Drop the first point of the tetra and keep the tetra pending if it holds more.
+		void drop_first_point() {
+			++processed_;
+			point_k head = thiz_->points_.next(thiz_->pool_.first_point(tetra_));
+			thiz_->pool_.store_first_point(tetra_, head);
+			if (head != NO_POINT) pending_.push_back(tetra_);
+		}
+		// Go on with the last pending tetra still alive and holding points, the closest
+		// to the last point inserted. Return false if there is none.
+		bool next_pending() {
+			while (!pending_.empty()) {
+				tetra_k t = pending_.back();
+				pending_.pop_back();
+				if (thiz_->is_alive(t) && thiz_->pool_.load_first_point(t) != NO_POINT) {
+					tetra_ = t;
+					return true;
+				}
+			}
+			return false;
+		}
+		// Insert the first point of tetra_. Return false if another task locks a point
+		// of its cavity, the tetra is then pending again.
+		bool triangulate_parallel() {
+			STATS(uint64_t phase_start = stats_clock());
+			bool locked = get_local_tetras(thiz_->pool_.first_point(tetra_), true);
+			STATS(thiz_->local_stats().cavity_cycles += stats_clock() - phase_start);
+			if (!locked) {
+				pending_.push_back(tetra_);
+				STATS(++thiz_->local_stats().retries);
+				lock_fail();
+				return false;
+			}
+			tetra_k first = -1;
+			try {
+				first = thiz_->pool_.allocate(num_new_slots());
+			} catch (std::bad_alloc const&) {
+			}
+			if (first == -1) {
+				// the pool is full or out of memory, nothing changed: stop the queue,
+				// the calling thread grows the pool and the tetra goes on, see run_jobs()
+				pending_.push_back(tetra_);
+				thiz_->pool_full_.store(true);
+				thiz_->job_queue_.pause();
+				return false;
+			}
+			replace_cavity(first);
+			// every point of the new tetras is locked by this task or is the new point
+			if (thiz_->coarser_) update_incident();
+			return true;
+		}
+	public:
+		// Replace the cavity found by get_local_tetras() with the star of the first point
+		// of tetra_, and add the new tetras holding points to pending_. The new tetras
+		// take the slots of the cavity, then num_new_slots() slots from first on; the
+		// slots of the cavity left over die. Only this task reads the cavity, so its
+		// slots are rewritten at once; a task still holding the key of one of them finds
+		// other points there once it locks them, see run().
+		void replace_cavity(tetra_k first) {
+			auto&& pool = thiz_->pool_;
+			auto&& points = thiz_->points_;
+			point_k pt_to_insert = pool.first_point(tetra_);
+			size_t num_new = boundary_.size();
+			size_t num_old = local_tetras_.size();
+			STATS(auto&& stats = thiz_->local_stats());
+			STATS(++stats.insertions);
+			++processed_;
+			STATS(stats.add_cavity(num_old));
+			STATS(stats.new_tetras += num_new);
+			STATS(uint64_t phase_start = stats_clock());
+
+			slots_.assign(local_tetras_.begin(), local_tetras_.begin() + std::min(num_old, num_new));
+			for (size_t b = num_old; b < num_new; ++b) slots_.push_back(first + tetra_k(b - num_old));
+			// read the cavity before writing over it: one new tetra per face of the
+			// cavity, made of the face and the new point, glued to the tetra outside
+			new_tetras_.resize(num_new);
+			for (size_t b = 0; b < num_new; ++b) {
+				tetra_k old_tetra = boundary_[b].first;
+				int i = boundary_[b].second;
+				auto&& n = new_tetras_[b];
+				n.vertices = pool.vertices(old_tetra);
+				n.vertices[i] = pt_to_insert;
+				n.outside = pool.neighbors(old_tetra)[i];
+				if (n.outside == FINAL_TETRA) continue;
+				auto&& nei = pool.neighbors(n.outside);
+				n.back = int(std::find(nei.begin(), nei.end(), old_tetra) - nei.begin());
+			}
+			heads_.resize(num_old);
+			for (size_t k = 0; k < num_old; ++k) heads_[k] = pool.first_point(local_tetras_[k]);
+			for (size_t k = num_new; k < num_old; ++k) pool.kill(local_tetras_[k]);
+			if (num_old > num_new) thiz_->num_dead_.fetch_add(num_old - num_new, std::memory_order_relaxed);
+
+			for (size_t b = 0; b < num_new; ++b) {
+				tetra_k new_tetra = slots_[b];
+				auto&& n = new_tetras_[b];
+				pool.store_vertices(new_tetra, n.vertices);
+				pool.neighbors(new_tetra)[boundary_[b].second] = n.outside;
+				pool.store_first_point(new_tetra, NO_POINT);
+				if (n.outside != FINAL_TETRA) pool.neighbors(n.outside)[n.back] = new_tetra;
+			}
+			link_new_tetras(pt_to_insert);
+			STATS(stats.build_cycles += stats_clock() - phase_start);
 
+			// redistribute the points of the cavity to the new tetras, appending to keep
+			// their order
+			STATS(phase_start = stats_clock());
+			tails_.assign(num_new, NO_POINT);
+			for (auto&& head : heads_) {
+				point_k pt = head;
+				while (pt != NO_POINT) {
+					point_k next = points.next(pt);
+					if (pt != pt_to_insert) {
+						int b = find_new_tetra(pt);
+						if (b != -1) {
+							points.next(pt) = NO_POINT;
+							point_k& tail = tails_[b];
+							if (tail == NO_POINT) pool.store_first_point(slots_[b], pt);
+							else points.next(tail) = pt;
+							tail = pt;
+						}
+						STATS(++stats.redistributed);
+					}
+					pt = next;
+				}
+			}
+			STATS(stats.redistribute_cycles += stats_clock() - phase_start);
+
+			// the new tetras holding points are pending
+			for (auto&& new_tetra : slots_) {
+				if (pool.first_point(new_tetra) != NO_POINT) pending_.push_back(new_tetra);
+			}
+			for (auto&& new_tetra : slots_) {
+				if (thiz_->is_infinite(new_tetra)) {
+					// the cavity reached the hull, keep the hull walk seed alive
+					std::lock_guard<std::mutex> hull_lock(thiz_->hull_hint_mutex_);
+					thiz_->hull_hint_ = new_tetra;
+					break;
+				}
+			}
 		}
 	private:
-      		// Triangulate with parallel
-		void triangulate_parallel(std::vector<point_k>& points_in_tetra) {
-                    std::vector<point_mutex*> mutexs;
-                    std::unordered_set<tetra, tetra_hash> local_tetras;
-                    std::unordered_set<tetra, tetra_hash> boundary_tetras;
-                    std::unordered_set<point_k> pts_locked;
-                    point_k pt_to_insert = points_in_tetra[0];
-                    for (int i = 0; i < 4; i++) pts_locked.insert(tetra_[i]);
-                    int test = get_local_tetras(mutexs, local_tetras, pts_locked, boundary_tetras, pt_to_insert, tetra_);
-                    if(test == -1) {
-                        //unlock mutexs, new task, and return
-                        for(auto&& m : mutexs ) {
-			    m->unlock();
-			}
-			thiz_->create_new_task(tetra_);
-			lock_fail();
-			return;
-                    }
-                    //cout<<"ddd"<<endl;
-                    // locked and local_tetras find, begin to process
-		    std::unordered_set<triangle, triangle_hash> local_triangles;
-                    get_local_triangles(local_triangles, local_tetras);
-                    std::vector<tetra> new_tetras;
-                    std::vector<tetra_data> tdata_list;
-                    for(auto&& tri_to_connect : local_triangles) {
-                        tetra t = {tri_to_connect[0], tri_to_connect[1], tri_to_connect[2], pt_to_insert};
-                        std::sort(t.begin(), t.end());
-                        new_tetras.push_back(t);
-                        tetra_data t_data_tmp;
-                        for (int i_t = 0; i_t < 4; i_t++) {
-                            for (int i_v = 0; i_v < 4; i_v++)
-                                t_data_tmp.neighbor[i_t][i_v] = -1;
-                        }
-                        tdata_list.push_back(t_data_tmp);
-                    }
-
-
-
-                    // redistribute points to new_tetras and calculate neighbors for new_tetras
-                    // distribute tetra_'s remainning points to new_tetras
-                    if(points_in_tetra.size() > 1) {
-		        for (std::vector<point_k>::iterator it = points_in_tetra.begin()+1 ; it != points_in_tetra.end(); ++it) {
-                            for (int itetra = 0; itetra < new_tetras.size(); itetra++) {
-                                auto&& t = new_tetras[itetra];
-                                if( intetra(thiz_->point_datas_[t[0]].pos.data(), 
-					thiz_->point_datas_[t[1]].pos.data(),
-					thiz_->point_datas_[t[2]].pos.data(),
-					thiz_->point_datas_[t[3]].pos.data(),
-					thiz_->point_datas_[*it].pos.data() ) > 0 ) {
-                                    tdata_list[itetra].pts_intetra.push_back(*it);
-			    	    break; 
-			        }
-			    }
-			}
-		    }
-                    // delete tetra_ from local_tetra
-                    local_tetras.erase(tetra_);
-                    // now distibute the points of other tetras to new tetras
-		    for (auto&& old_tetra : local_tetras ) {
-			tetra_map::accessor a;
-			thiz_->tetra_to_points_.find(a,old_tetra);
-			auto t_data_tmp = a->second;
-			a.release();
-			for (std::vector<point_k>::iterator it = t_data_tmp->pts_intetra.begin() ; it != t_data_tmp->pts_intetra.end(); ++it) { 
-                            for (int itetra=0; itetra < new_tetras.size(); itetra++) {
-                                auto&& t = new_tetras[itetra];
-				if( intetra(thiz_->point_datas_[t[0]].pos.data(), 
-				        thiz_->point_datas_[t[1]].pos.data(),
-				        thiz_->point_datas_[t[2]].pos.data(),
-				        thiz_->point_datas_[t[3]].pos.data(),
-				        thiz_->point_datas_[*it].pos.data() ) > 0 ) {
-				        tdata_list[itetra].pts_intetra.push_back(*it);
-				    break; 
-				}
-			    }
-			}
-                        // local_tetras has been deleted from tetra hashmap
-			thiz_->tetra_to_points_.erase(old_tetra);
-		    }
-                    thiz_->tetra_to_points_.erase(tetra_);
-                    // insert tetra_ back
-                    local_tetras.insert(tetra_);
-
-                    // update new tetras' neighbors
-                    for (int itetra = 0; itetra < new_tetras.size(); itetra++) {
-                        //cout<<"new tetra "<<new_tetras[itetra][0]<<" "<<new_tetras[itetra][1]<<" "<<new_tetras[itetra][2]<<" "<<new_tetras[itetra][3]<<endl;
-                        // compare with new_tetras
-                        for (int jtetra = 0; jtetra < new_tetras.size(); jtetra++) {
-                            if(itetra == jtetra)
-                                continue;
-                            if (neighbor_tetra(new_tetras[itetra], new_tetras[jtetra]) == 3) {
-                                // update tdata_list[itetra].neighbor
-                                for(auto&& nei : tdata_list[itetra].neighbor) {
-                                    if(nei[0] == -1) {
-                                        nei[0] = new_tetras[jtetra][0];
-                                        nei[1] = new_tetras[jtetra][1];
-                                        nei[2] = new_tetras[jtetra][2];
-                                        nei[3] = new_tetras[jtetra][3];
-                                        break;    
-                                    }   
-                                }
-                            }
-                        }
-                        // compare with boundary tetras
-                        for (auto&& b_tetra : boundary_tetras) {
-                           if (neighbor_tetra(new_tetras[itetra], b_tetra) == 3) {
-                                // update tdata_list[itetra].neighbor
-                                for(auto&& nei : tdata_list[itetra].neighbor) {
-                                    if(nei[0] == -1) {
-                                        nei[0] = b_tetra[0];
-                                        nei[1] = b_tetra[1];
-                                        nei[2] = b_tetra[2];
-                                        nei[3] = b_tetra[3];
-                                        break;    
-                                    }   
-                                }
-                            } 
-                        }
-                    }
-
-                    // delete boundary tetras whose neighbor contain local_tetras, and if new_tetras are its neighbor add to it 
-                    for( auto&& b_tetra : boundary_tetras) {
-                        tetra_map::accessor ac;
-                        thiz_->tetra_to_points_.find(ac, b_tetra);
-                        // test with try get t_data and release ac;
-                        auto&& t_data = ac->second;
-                        ac.release();
-                        for(int neighbor_i = 0; neighbor_i < 4; neighbor_i++) {
-                            for(auto&& l_tetra : local_tetras) {
-                                int flag_eq = 1;
-                                for(int v_i = 0; v_i < 4; v_i++) {
-                                    if(t_data->neighbor[neighbor_i][v_i] != l_tetra[v_i]) {
-                                        flag_eq = 0;
-                                        break;
-                                    }
-                                }
-                                if(flag_eq == 0)
-                                    continue;
-                                // find com tri of this local_tetra and b_tetra
-                                std::vector<point_k> com_vs;
-                                for(int i=0; i<4; i++) {
-                                    for(int j=0; j<4; j++) {
-                                        if(b_tetra[i] == l_tetra[j]){
-                                            com_vs.push_back(b_tetra[i]);
-                                            break;
-                                        }
-                                    }
-                                }
-                                com_vs.push_back(pt_to_insert);
-                                std::sort(com_vs.begin(),com_vs.end());
-                                for(int i=0; i<4; i++) {
-                                    t_data->neighbor[neighbor_i][i] = com_vs[i];
-                                }
-                                break;
-                            }
-                        }
-                    }
-
-                    // delete local_tetras from tetra hashmap, add new_tetras to hashmap and create new task
-                    for (int itetra = 0; itetra < new_tetras.size(); itetra++) {
-                        thiz_->tetra_to_points_.insert(tetra_map::value_type(new_tetras[itetra], make_shared<tetra_data>(tdata_list[itetra])));
-                        if(tdata_list[itetra].pts_intetra.size() > 0) {
-                            thiz_->create_new_task(new_tetras[itetra]);
-                        }
-                    }
-
-                    for(auto&& m : mutexs) {
-                        m->unlock();
-                    }
-
-                }
-        
-
-                // return 1 if lock success and local_tetras calculated
-                int get_local_tetras( std::vector<point_mutex*>& mutexs,
-				    std::unordered_set<tetra, tetra_hash>& local_tetras,
-                                    std::unordered_set<point_k>& pts_locked,
-				    std::unordered_set<tetra, tetra_hash>& boundary_tetras,
-                                    point_k pt_to_insert, tetra curr_tetra) {
-                    local_tetras.insert(curr_tetra);
-                    tetra_map::accessor ac;
-                    thiz_->tetra_to_points_.find(ac, curr_tetra);
-                    auto t_data = ac->second;
-                    ac.release();
-                    for(auto&& t : t_data->neighbor) { 
-                        //if in local_teras
-                        //continue
-                        if(local_tetras.find(t) != local_tetras.end())
-                            continue;
-                        if(t[0] == -1)
-                            continue;
-             	        if( insphere_with_adjust(thiz_->point_datas_[t[0]].pos.data(), 
-		            thiz_->point_datas_[t[1]].pos.data(),
-		            thiz_->point_datas_[t[2]].pos.data(),
-		            thiz_->point_datas_[t[3]].pos.data(),
-		            thiz_->point_datas_[pt_to_insert].pos.data() ) > 0 ) {
-                            // try lock the vertex not locked yet  
-                            for (auto&& v : t) {
-                                //find the one not in pts_locked to lock
-                                if(pts_locked.find(v) == pts_locked.end()) {
-                                    //try lock
-        	                    auto&& m = thiz_->point_datas_[v].p_mutex;
-                                    //if success lock, add pts_locked, add mutexs and call recusive
-			            if(m.try_lock()) {
-			                mutexs.push_back(&m);
-                                        pts_locked.insert(v);
-                                    }
-			            else {
-                             //           cout<<"try lock fail"<<endl;
-                                        return -1;
-                                    }
-                                    break;
-                                } 
-                            }
-                            // vertex locked, call recursive
-                            int test = get_local_tetras(mutexs, local_tetras, pts_locked, boundary_tetras, pt_to_insert, t);
-                            if (test == -1)
-                                return -1; 
-                        } 
-                        else {
-                            boundary_tetras.insert(t);
-                            //continue;
-                        }
-                    }
-                    return 1;
-                } 
-
-
-
-                void get_local_triangles (std::unordered_set<triangle, triangle_hash>& local_triangles , std::unordered_set<tetra, tetra_hash>& local_tetras) {
-                    for(auto&& local_t : local_tetras) {
-            	        // insert to local triangles
-                        //cout<<"local tetra "<<local_t[0]<<" "<<local_t[1]<<" "<<local_t[2]<<" "<<local_t[3]<<endl;
-			triangle tri_insert1 = {local_t[0],local_t[1],local_t[2]};
-			triangle tri_insert2 = {local_t[0],local_t[2],local_t[3]};
-			triangle tri_insert3 = {local_t[1],local_t[2],local_t[3]};
-			triangle tri_insert4 = {local_t[0],local_t[1],local_t[3]};
-			
-                        if( local_triangles.find(tri_insert1) == local_triangles.end() )
-			    local_triangles.insert(tri_insert1);
-			else
-			    local_triangles.erase(tri_insert1);
-			
-                        if( local_triangles.find(tri_insert2) == local_triangles.end() )
-			    local_triangles.insert(tri_insert2);
-			else
-			    local_triangles.erase(tri_insert2);
-                        
-                        if( local_triangles.find(tri_insert3) == local_triangles.end() )
-			    local_triangles.insert(tri_insert3);
-			else
-			    local_triangles.erase(tri_insert3);
-
-                        if( local_triangles.find(tri_insert4) == local_triangles.end() )
-			    local_triangles.insert(tri_insert4);
-			else
-			    local_triangles.erase(tri_insert4);		
-                    }
-                }
-
-                int neighbor_tetra(tetra tetra_a, tetra tetra_b) {
-                    int count = 0;
-                    for (int i = 0; i < 4; i++) {
-                        for (int j = 0; j < 4; j++) {
-                            if(tetra_a[i] == tetra_b[j]) {
-                                count++;
-                                break;
-                            }
-                        }
-                    }
-                    return count;
-                }
-
-            
-		
-
-		      
-		// Try to lock the points of the tetra. Return true iff all points are locked.
+
+		// Collect the tetras in conflict with pt_to_insert, starting from tetra_, and the
+		// faces bounding them. Lock the points of every tetra collected if lock.
+		// Return false if some point is locked by another task.
+		bool get_local_tetras(point_k pt_to_insert, bool lock) {
+			auto&& pool = thiz_->pool_;
+			STATS(auto&& stats = thiz_->local_stats());
+			local_tetras_.assign(1, tetra_);
+			boundary_.clear();
+			for (size_t k = 0; k < local_tetras_.size(); ++k) {
+				tetra_k curr_tetra = local_tetras_[k];
+				for (int i = 0; i <= D; ++i) {
+					tetra_k t = pool.neighbors(curr_tetra)[i];
+					if (std::find(local_tetras_.begin(), local_tetras_.end(), t) != local_tetras_.end())
+						continue;
+					STATS(if (t != FINAL_TETRA) ++stats.conflict_tests);
+					if (t == FINAL_TETRA || !thiz_->in_conflict(t, pt_to_insert)) {
+						boundary_.push_back(std::make_pair(curr_tetra, i));
+						continue;
+					}
+					// t shares a face with curr_tetra, lock the point that is not locked yet
+					for (auto&& v : pool.vertices(t)) {
+						if (!lock || v == thiz_->inf_ || std::find(mutexs_.begin(), mutexs_.end(), &thiz_->points_.lock(v)) != mutexs_.end())
+							continue;
+						auto&& m = thiz_->points_.lock(v);
+						STATS(++stats.lock_attempts);
+						if (!m.try_lock()) {
+							STATS(++stats.lock_failures);
+							return false;
+						}
+						mutexs_.push_back(&m);
+					}
+					local_tetras_.push_back(t);
+				}
+			}
+			return true;
+		}
+
+		// Set the neighbors of the new tetras in slots_ across their faces containing
+		// the new point. Such a face contains exactly one edge of the cavity boundary
+		// (a point in 2D), and each is shared by two of the new tetras.
+		void link_new_tetras(point_k pt_to_insert) {
+			auto&& pool = thiz_->pool_;
+			std::vector<std::pair<std::array<point_k, D - 1>, std::pair<tetra_k, int> > > edges;
+			edges.reserve(D * slots_.size());
+			for (auto&& new_tetra : slots_) {
+				auto&& t = pool.vertices(new_tetra);
+				for (int j = 0; j <= D; ++j) {
+					if (t[j] == pt_to_insert) continue;
+					std::array<point_k, D - 1> edge{};
+					int n = 0;
+					for (int k = 0; k <= D; ++k) {
+						if (k == j || t[k] == pt_to_insert) continue;
+						edge[n++] = t[k];
+					}
+					if (edge.front() > edge.back()) std::swap(edge.front(), edge.back());
+					edges.push_back(std::make_pair(edge, std::make_pair(new_tetra, j)));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			STATS(thiz_->local_stats().link_edges += edges.size());
+			for (size_t e = 0; e + 1 < edges.size(); e += 2) {
+				auto&& a = edges[e].second;
+				auto&& b = edges[e + 1].second;
+				pool.neighbors(a.first)[a.second] = b.first;
+				pool.neighbors(b.first)[b.second] = a.first;
+			}
+		}
+
+		// Return the index in slots_ of the new tetra whose region contains pt, preferring
+		// strict containment. Return -1 if there is none.
+		int find_new_tetra(point_k pt) {
+			int ret = -1;
+			for (int b = 0; b < int(slots_.size()); ++b) {
+				STATS(++thiz_->local_stats().region_tests);
+				int res = thiz_->in_region(slots_[b], pt);
+				if (res > 0)
+					return b;
+				if (res == 0 && ret == -1)
+					ret = b;
+			}
+			return ret;
+		}
+
+		// Try to lock the points of the tetra, kept in locked_. Return true iff all points
+		// are locked. The infinite vertex is never locked, every tetra has D finite points
+		// guarding it.
 		bool try_lock_tetra_points() {
-			return -1 == std::try_lock(
-					thiz_->point_datas_[tetra_[0]].p_mutex, 
-					thiz_->point_datas_[tetra_[1]].p_mutex, 
-					thiz_->point_datas_[tetra_[2]].p_mutex, 
-					thiz_->point_datas_[tetra_[3]].p_mutex);
+			locked_ = thiz_->pool_.load_vertices(tetra_);
+			for (auto&& v : locked_) {
+				if (v == thiz_->inf_) continue;
+				auto&& m = thiz_->points_.lock(v);
+				STATS(++thiz_->local_stats().lock_attempts);
+				if (!m.try_lock()) {
+					STATS(++thiz_->local_stats().lock_failures);
+					unlock_points();
+					return false;
+				}
+				mutexs_.push_back(&m);
+			}
+			return true;
 		}
-		void unlock_tetra_points() {
-			for (size_t i = 0; i < 4; ++i) {
-				thiz_->point_datas_[tetra_[i]].p_mutex.unlock();
+		void unlock_points() {
+			for (auto&& m : mutexs_) {
+				m->unlock();
 			}
+			mutexs_.clear();
+			local_tetras_.clear();
+			boundary_.clear();
 		}
 		void lock_fail() {
 //			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		}
-		triangulator* thiz_;
-		tetra tetra_;
+		basic_triangulator* thiz_;
+		tetra_k tetra_;
+		// points of tetra_ when they were locked
+		tetra locked_;
+		std::vector<point_mutex*> mutexs_;
+		// last point of the conflict list of each new tetra while redistributing
+		std::vector<point_k> tails_;
+		// tetras in conflict with the point to insert
+		std::vector<tetra_k> local_tetras_;
+		// faces of the cavity, as a tetra in conflict and the index of the point opposite the face
+		std::vector<std::pair<tetra_k, int> > boundary_;
+		// a new tetra per face of the cavity, read before the cavity is written over:
+		// its points, the tetra outside across the face and the index of the cavity there
+		struct star_tetra {
+			tetra vertices;
+			tetra_k outside;
+			int back;
+		};
+		std::vector<star_tetra> new_tetras_;
+		// slot of each new tetra, and the conflict lists of the cavity
+		std::vector<tetra_k> slots_;
+		std::vector<point_k> heads_;
+		// tetras holding points, left for the next insertion or for new tasks
+		std::vector<tetra_k> pending_;
+		// points inserted or dropped, not yet added to num_processed_
+		size_t processed_;
+		// tetras claimed in a round, the cavity and the tetras across its faces, and the
+		// priority of the point
+		std::vector<tetra_k> claimed_;
+		uint32_t priority_;
 	};
 
-public:
-	// Return 4 points which can form a tetra containing all points.
-    // Presumptin:
-    //  all points are generated randomly from [0, 1)
-	static std::array<xyz, 4> get_hull_xyzs(std::vector<xyz> const& points) {
-        // TODO the tetra seems large enough, should we test?
-        xyz vs[4] = {
-            {  0, 0, 10 },
-            { 10, 0, 0 },
-            {  0,10, 0 },
-            {  -5, -5,  -5 }
-        };
-
-        std::array<xyz, 4> ret =  {
-            vs[0], vs[1], vs[2], vs[3]
-        };
-		return ret;
+	// The task of each worker, run for every job it takes with its buffers kept.
+	std::vector<triangulation_task> worker_tasks_;
+
+	// A queued task, the tetra whose first point to insert, run by the task of the
+	// worker taking it. Two words, kept in the job itself instead of on the heap:
+	// there are about two jobs queued per point at the peak.
+	struct triangulation_job {
+		basic_triangulator* thiz;
+		tetra_k tetra;
+		void operator()() const {
+			auto&& task = thiz->worker_tasks_[job_queue::current_worker()];
+			task.reset(tetra);
+			task();
+		}
+	};
+
+	// *** PREDICATES ***
+
+	T* pos(point_k k) const {
+		return points_.pos(k);
+	}
+
+	REAL weight(point_k k) const {
+		return points_.weight(k);
+	}
+
+	// Orientation of q to face j of the tetra v, positive on the side of point j.
+	REAL face_orient(tetra const& v, int j, T* q) const {
+		T* f[D];
+		for (int k = 0; k < D; ++k) f[k] = pos(v[facet(j, k)]);
+		return dimension<D>::orient(f, q);
+	}
+
+	// Return true iff q is inside the circumsphere of t, or for weighted points in
+	// conflict with its orthogonal sphere by the power test. For an infinite tetra
+	// the circumsphere degenerates to the open half space beyond its hull face,
+	// plus the circumcircle of the face itself.
+	bool in_conflict(tetra_k t, point_k q) const {
+		auto&& v = pool_.vertices(t);
+		int i = infinite_index(t);
+		T* p[D + 1];
+		REAL w[D + 1];
+		if (i == -1) {
+			for (int k = 0; k <= D; ++k) p[k] = pos(v[k]);
+			if (weighted_) {
+				for (int k = 0; k <= D; ++k) w[k] = weight(v[k]);
+				return dimension<D>::powertest(p, w, pos(q), weight(q)) > 0;
+			}
+			return dimension<D>::insphere(p, pos(q)) > 0;
+		}
+		for (int k = 0; k < D; ++k) p[k] = pos(v[facet(i, k)]);
+		REAL res = dimension<D>::orient(p, pos(q));
+		if (res != 0) return res > 0;
+		// q is on the plane of the face, the sphere through the face and any point
+		// off the plane cuts the plane in the circumcircle of the face. Weighted, the
+		// sphere orthogonal to the face and to center_ of weight 0 cuts it in the
+		// circle orthogonal to the face. In 2D q is on the line of the edge, and in
+		// conflict between its points. The face reversed and center_ are positive.
+		std::swap(p[D - 2], p[D - 1]);
+		p[D] = const_cast<T*>(center_.data());
+		if (weighted_) {
+			for (int k = 0; k < D; ++k) w[k] = weight(v[facet(i, k)]);
+			std::swap(w[D - 2], w[D - 1]);
+			w[D] = 0;
+			return dimension<D>::powertest(p, w, pos(q), weight(q)) > 0;
+		}
+		return dimension<D>::insphere(p, pos(q)) > 0;
+	}
+
+	// Like intetra(), return -1 if q is outside the region of t, 0 on its boundary, 1 inside.
+	// The region of an infinite tetra is the part of the cone from center_ through its hull
+	// face that lies beyond the face. These regions and the finite tetras partition space,
+	// and the regions of a cavity are always covered by the regions of the new tetras.
+	int in_region(tetra_k t, point_k q) const {
+		return in_region(t, pos(q));
+	}
+	int in_region(tetra_k t, T* q) const {
+		auto&& v = pool_.vertices(t);
+		int i = infinite_index(t);
+		bool on_boundary = false;
+		if (i == -1) {
+			for (int j = 0; j <= D; ++j) {
+				REAL res = face_orient(v, j, q);
+				if (res < 0) return -1;
+				if (res == 0) on_boundary = true;
+			}
+			return on_boundary ? 0 : 1;
+		}
+		T* o = const_cast<T*>(center_.data());
+		T* f[D];
+		for (int k = 0; k < D; ++k) f[k] = pos(v[facet(i, k)]);
+		REAL res = dimension<D>::orient(f, q);
+		if (res < 0) return -1;
+		if (res == 0) on_boundary = true;
+		// the sides of the cone, the face is on their positive side
+		for (int j = 0; j < D; ++j) {
+			res = dimension<D>::cone_side(o, f, j, q);
+			if (res < 0) return -1;
+			if (res == 0) on_boundary = true;
+		}
+		return on_boundary ? 0 : 1;
+	}
+
+	// Pick D + 1 points in general position to seed the triangulation: the lowest point,
+	// the point farthest from it, the point farthest from their line and in 3D the point
+	// farthest from their plane. Return false if the points are all coplanar (collinear).
+	bool get_initial_tetra(tetra& t) const {
+		point_k n = points_.size();
+		if (n < D + 1) return false;
+		auto dist2 = [](point_type const& a, point_type const& b) {
+			REAL ret = 0;
+			for (int k = 0; k < D; ++k) ret += (REAL(a[k]) - b[k]) * (REAL(a[k]) - b[k]);
+			return ret;
+		};
+		point_k a = 0;
+		for (point_k i = 1; i < n; ++i) {
+			if (points_[i] < points_[a]) a = i;
+		}
+		point_k b = a;
+		for (point_k i = 0; i < n; ++i) {
+			if (dist2(points_[a], points_[i]) > dist2(points_[a], points_[b])) b = i;
+		}
+		if (b == a) return false;
+		t[0] = a;
+		t[1] = b;
+		T* p[D];
+		p[0] = pos(a);
+		p[1] = pos(b);
+		for (int k = 2; k <= D; ++k) {
+			point_k c = a;
+			REAL best = 0;
+			for (point_k i = 0; i < n; ++i) {
+				REAL spread = dimension<D>::spread(p, k, pos(i));
+				if (spread > best) {
+					best = spread;
+					c = i;
+				}
+			}
+			if (c == a) return false;
+			t[k] = c;
+			if (k < D) p[k] = pos(c);
+		}
+		return true;
 	}
 
-	// All points including 4 hull points.
-	std::unique_ptr<point_data[]> point_datas_;
-	// A map containing all valid tetras and the points in them.
-	tetra_map tetra_to_points_;
+	// Center and radius of the circumsphere of the finite tetra t, in floating point.
+	// A tetra too flat for them to mean anything gets its first point and an infinite radius.
+	void circumsphere(tetra_k t, xyz& center, REAL& radius) const {
+		auto&& v = pool_.vertices(t);
+		xyz const& a = points_[v[0]];
+		xyz e[3];
+		REAL len2[3];
+		for (int j = 0; j < 3; ++j) {
+			for (int k = 0; k < 3; ++k) e[j][k] = points_[v[j + 1]][k] - a[k];
+			len2[j] = e[j][0] * e[j][0] + e[j][1] * e[j][1] + e[j][2] * e[j][2];
+		}
+		// cross[j] is the cross product of the two other edges, in cyclic order
+		xyz cross[3];
+		for (int j = 0; j < 3; ++j) {
+			xyz const& p = e[(j + 1) % 3];
+			xyz const& q = e[(j + 2) % 3];
+			cross[j] = {p[1] * q[2] - p[2] * q[1], p[2] * q[0] - p[0] * q[2], p[0] * q[1] - p[1] * q[0]};
+		}
+		REAL det = e[0][0] * cross[0][0] + e[0][1] * cross[0][1] + e[0][2] * cross[0][2];
+		if (!(std::fabs(det) > 1e-10 * std::sqrt(len2[0] * len2[1] * len2[2]))) {
+			center = a;
+			radius = std::numeric_limits<REAL>::infinity();
+			return;
+		}
+		REAL r2 = 0;
+		for (int k = 0; k < 3; ++k) {
+			REAL offset = (len2[0] * cross[0][k] + len2[1] * cross[1][k] + len2[2] * cross[2][k]) / (2 * det);
+			center[k] = a[k] + offset;
+			r2 += offset * offset;
+		}
+		radius = std::sqrt(r2);
+	}
 
-    //std::vector<tetras> vecTetras_;
+	// Drop the finite tetras for which is_final(center, radius) of their circumsphere
+	// holds, after handing them to emit in pool order. Their live neighbors see
+	// FINAL_TETRA across the shared face. The pool is compacted, and the pages of points
+	// no tetra uses anymore are released. Only between runs, 3D and double only.
+	template <typename IsFinal, typename Emit>
+	void finalize(IsFinal const& is_final, Emit emit) {
+		static_assert(D == 3 && std::is_same<T, REAL>::value, "finalize() is 3D and double only");
+		size_t size = pool_.size();
+		std::vector<char> finalized(size, 0);
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(size_t(0), size, [&](size_t t) {
+				if (!is_alive(t) || is_infinite(t)) return;
+				xyz center;
+				REAL radius;
+				circumsphere(t, center, radius);
+				finalized[t] = is_final(center, radius);
+			});
+		});
+		std::vector<tetra> tetras;
+		std::vector<tetra_k> new_keys(size, -1);
+		tetra_k count = 0;
+		for (size_t t = 0; t < size; ++t) {
+			if (finalized[t]) {
+				tetras.push_back(pool_.vertices(t));
+				for (auto&& nei : pool_.neighbors(t)) {
+					if (nei < 0 || finalized[nei]) continue;
+					for (auto&& nei_nei : pool_.neighbors(nei)) {
+						if (nei_nei == tetra_k(t)) nei_nei = FINAL_TETRA;
+					}
+				}
+			} else if (is_alive(t)) {
+				new_keys[t] = count++;
+			}
+		}
+		emit(span<tetra const>(tetras.data(), tetras.size()));
+		compact_pool(new_keys, count);
+		std::vector<char> used(points_.num_pages(), 0);
+		for (tetra_k t = 0; t < count; ++t) {
+			for (auto&& v : pool_.vertices(t)) {
+				if (v != inf_) used[v >> point_store::PAGE_BITS] = 1;
+			}
+		}
+		// the page the next points go to and the pages of points not inserted are kept
+		for (size_t page = 0; (page + 1) * point_store::PAGE_SIZE <= size_t(inserted_); ++page) {
+			if (!used[page] && !points_.released(page)) points_.release(page);
+		}
+	}
+
+	// Move slot t of the pool to new_keys[t], or drop it if that is -1, and renumber
+	// the neighbors of the count slots kept. A neighbor dropped must be FINAL_TETRA.
+	void compact_pool(std::vector<tetra_k> const& new_keys, tetra_k count) {
+		pool_.compact(new_keys);
+		tbb::task_arena arena(num_thread_);
+		arena.execute([&] {
+			tbb::parallel_for(tetra_k(0), count, [&](tetra_k t) {
+				for (auto&& nei : pool_.neighbors(t)) {
+					if (nei >= 0) nei = new_keys[nei];
+				}
+			});
+		});
+		if (hull_hint_ != -1) hull_hint_ = new_keys[hull_hint_];
+		if (coarser_) {
+			arena.execute([&] {
+				tbb::parallel_for(size_t(0), incident_.size(), [&](size_t k) {
+					if (incident_[k] >= 0) incident_[k] = new_keys[incident_[k]];
+				});
+			});
+		}
+		num_dead_ = 0;
+	}
+
+	// Positions and locks of the points.
+	basic_point_store<T> points_;
+	// All tetras ever created, with their neighbors and the points in them.
+	simplex_pool<D> pool_;
 
+	// Key of the infinite vertex, larger than any point key.
+	point_k inf_;
+	// A point strictly inside the convex hull, used to orient hull faces.
+	point_type center_;
+	// Some infinite tetra, the seed of the hull walk.
+	tetra_k hull_hint_;
+	std::mutex hull_hint_mutex_;
+	// Number of points handed to the triangulation, the others wait for a seed.
+	point_k inserted_;
+	// Number of dead slots in the pool.
+	std::atomic<size_t> num_dead_;
+	// see num_processed()
+	std::atomic<size_t> num_processed_;
+	// Whether a task found the tetra pool full, see run_jobs().
+	std::atomic<bool> pool_full_;
+
+	// Some points have weights, the triangulation is a regular one.
+	bool weighted_;
+
+	// Insert in rounds, see location_mode.
+	bool hierarchy_;
+	// Points before sampled_ went to the coarser level if they are in its sample.
+	point_k sampled_;
+	// The next level of the hierarchy, null at the coarsest level and without hierarchy.
+	std::unique_ptr<basic_triangulator> coarser_;
+	// Key in the level below of each point of this level.
+	std::vector<point_k> down_;
+	// A live tetra around each vertex, -1 for the other points, kept up to date while
+	// there is a coarser level.
+	std::vector<tetra_k> incident_;
+
+	// Insert in rounds, see insertion_mode.
+	bool rounds_;
+	// While inserting in rounds, the smallest round_priority() of the points claiming
+	// each tetra slot, NO_OWNER if none; NO_OWNER for all between rounds.
+	static uint32_t const NO_OWNER = 0xffffffffu;
+	std::vector<std::atomic<uint32_t> > owners_;
+
+	// The points from refine_first_ on are the circumcenters of the refine() round
+	// running, of the tetras refine_sources_[k - refine_first_], kept with their points
+	// since the slot of a tetra replaced may hold another.
+	point_k refine_first_;
+	std::vector<std::pair<tetra_k, tetra> > refine_sources_;
 };
+
+template <int D, typename T>
+point_k const basic_triangulator<D, T>::NO_POINT;
+template <int D, typename T>
+point_k const basic_triangulator<D, T>::HIERARCHY_MIN_ROUND;
+
+typedef basic_triangulator<3> triangulator;
+// Triangulates the x and y of the points, see dimension.h.
+typedef basic_triangulator<2> triangulator_2d;
+// Triangulate float points, xyzf.
+typedef basic_triangulator<3, float> triangulator_f32;
+typedef basic_triangulator<2, float> triangulator_2d_f32;
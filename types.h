@@ -2,6 +2,8 @@
 
 // STL
 #include <array>
+#include <cstddef>
+#include <type_traits>
 // Boost
 #include <boost/functional/hash.hpp>
 
@@ -10,6 +12,8 @@
 
 // Coordinate of a point.
 typedef std::array<REAL, 3> xyz;
+// Coordinate of a point in single precision, for clouds stored as floats.
+typedef std::array<float, 3> xyzf;
 
 // The key of a point. (point_k is more meaningful than size_t/int)
 //typedef size_t point_k;
@@ -21,6 +25,38 @@ typedef std::array<point_k, 4> tetra;
 // A triangle represented by 3 keys of its points
 typedef std::array<point_k, 3> triangle;
 
+// The key of a tetra, its slot in the tetra pool.
+typedef int tetra_k;
+// The 4 neighbors of a tetra, neighbor i is across the face opposite point i.
+typedef std::array<tetra_k, 4> tetra_neighbors;
+
+// A simplex of a D dimensional triangulation and its neighbors: a tetra in 3D, a
+// triangle in 2D. A 2D triangulation uses the x and y of its points and ignores z.
+template <int D>
+using simplex = std::array<point_k, D + 1>;
+template <int D>
+using simplex_neighbors = std::array<tetra_k, D + 1>;
+
+// A view of contiguous elements owned by someone else.
+template <typename T>
+struct span {
+	span() : ptr_(nullptr), size_(0) {}
+	span(T* ptr, size_t size) : ptr_(ptr), size_(size) {}
+	// a view of T converts to a view of T const
+	template <typename U>
+	span(span<U> const& other, typename std::enable_if<std::is_convertible<U*, T*>::value>::type* = 0) :
+		ptr_(other.data()), size_(other.size()) {}
+	T* begin() const { return ptr_; }
+	T* end() const { return ptr_ + size_; }
+	T* data() const { return ptr_; }
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	T& operator[](size_t i) const { return ptr_[i]; }
+private:
+	T* ptr_;
+	size_t size_;
+};
+
 // Corresponding hash class
 struct tetra_hash {
 	static size_t hash(tetra const& x){
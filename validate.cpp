@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include "validate.h"
+using namespace std;
+
+
+// Tetras per block, the unit of parallel work.
+static size_t const VALIDATE_GRAIN = 1 << 12;
+
+// Vertices of the face opposite vertex i, oriented so that vertex i is on its
+// positive side, as in the triangulator.
+static int const FACET[4][3] = {{1, 3, 2}, {0, 2, 3}, {0, 3, 1}, {0, 1, 2}};
+
+// The 6 edges of a tetra as pairs of vertex indices.
+static int const EDGES[6][2] = {{0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+
+validation_report::validation_report() :
+    num_tetras(0), num_vertices(0), num_edges(0), num_faces(0), num_hull_faces(0),
+    num_bad_vertices(0), num_inverted(0), num_bad_adjacency(0), num_non_delaunay(0),
+    volume(0), hull_volume(0), volume_ok(true), euler_characteristic(0)
+{
+}
+
+bool validation_report::ok() const
+{
+    return num_bad_vertices == 0 && num_inverted == 0 && num_bad_adjacency == 0 && num_non_delaunay == 0
+        && volume_ok && (num_tetras == 0 || euler_characteristic == 1);
+}
+
+static void write_keys(ostream& os, char const* what, size_t num, vector<tetra_k> const& keys)
+{
+    if (num == 0)
+        return;
+    os << num << ' ' << what << " tetras:";
+    for (auto&& t : keys)
+        os << ' ' << t;
+    if (keys.size() < num)
+        os << " ...";
+    os << "\n";
+}
+
+void validation_report::write_text(ostream& os) const
+{
+    os << "tetras: " << num_tetras << ", vertices: " << num_vertices << ", edges: " << num_edges
+       << ", faces: " << num_faces << " (" << num_hull_faces << " on the hull)\n"
+       << "euler characteristic: ";
+    if (num_bad_vertices == 0 && num_bad_adjacency == 0)
+        os << euler_characteristic << "\n";
+    else
+        os << "not counted, the adjacency is broken\n";
+    os << "volume: " << volume << ", enclosed by the hull: " << hull_volume << (volume_ok ? "" : " (mismatch)") << "\n";
+    write_keys(os, "bad vertex", num_bad_vertices, bad_vertices);
+    write_keys(os, "inverted", num_inverted, inverted);
+    write_keys(os, "bad adjacency", num_bad_adjacency, bad_adjacency);
+    write_keys(os, "non Delaunay", num_non_delaunay, non_delaunay);
+    os << (ok() ? "valid" : "INVALID") << "\n";
+}
+
+// What a block of tetras found, merged into the report.
+struct block_result
+{
+    size_t num_edges = 0;
+    size_t num_hull_faces = 0;
+    REAL volume = 0;
+    REAL abs_volume = 0;
+    REAL hull_volume = 0;
+    REAL abs_hull_volume = 0;
+    size_t num_bad[4] = {0, 0, 0, 0};
+    vector<tetra_k> bad[4];
+};
+
+enum { BAD_VERTICES, INVERTED, BAD_ADJACENCY, NON_DELAUNAY };
+
+// Run f(t, result) on the tetras [0, num) in parallel, and merge the results of
+// the blocks into one, keeping the max_reported smallest offending tetras of each kind.
+template <typename F>
+static block_result for_blocks(size_t num, int num_threads, size_t max_reported, F f)
+{
+    block_result ret;
+    mutex ret_mutex;
+    tbb::task_arena arena(num_threads > 0 ? num_threads : int(tbb::task_arena::automatic));
+    arena.execute([&] {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num, VALIDATE_GRAIN), [&](tbb::blocked_range<size_t> const& r) {
+            block_result res;
+            for (size_t t = r.begin(); t != r.end(); ++t)
+                f(tetra_k(t), res);
+            lock_guard<mutex> lock(ret_mutex);
+            ret.num_edges += res.num_edges;
+            ret.num_hull_faces += res.num_hull_faces;
+            ret.volume += res.volume;
+            ret.abs_volume += res.abs_volume;
+            ret.hull_volume += res.hull_volume;
+            ret.abs_hull_volume += res.abs_hull_volume;
+            for (int k = 0; k < 4; ++k)
+            {
+                ret.num_bad[k] += res.num_bad[k];
+                ret.bad[k].insert(ret.bad[k].end(), res.bad[k].begin(), res.bad[k].end());
+                sort(ret.bad[k].begin(), ret.bad[k].end());
+                if (ret.bad[k].size() > max_reported)
+                    ret.bad[k].resize(max_reported);
+            }
+        });
+    });
+    return ret;
+}
+
+bool validate_mesh(span<xyz const> points, span<tetra const> tetras, span<tetra_neighbors const> neighbors,
+    validation_report& report, int num_threads, size_t max_reported, span<REAL const> weights)
+{
+    report = validation_report();
+    size_t num = tetras.size();
+    report.num_tetras = num;
+    auto pos = [&](point_k k) { return const_cast<REAL*>(points[k].data()); };
+    auto report_bad = [&](block_result& res, int kind, tetra_k t) {
+        if (res.num_bad[kind]++ < max_reported)
+            res.bad[kind].push_back(t);
+    };
+    if (neighbors.size() != num)
+    {
+        // without adjacency nothing but the vertices can be trusted
+        report.num_bad_adjacency = num;
+        for (size_t t = 0; t < min(num, max_reported); ++t)
+            report.bad_adjacency.push_back(t);
+    }
+
+    // vertices, orientation, volume and vertices used
+    unique_ptr<atomic<unsigned char>[]> used(new atomic<unsigned char>[points.size()]());
+    vector<char> valid(num, 0);
+    block_result res = for_blocks(num, num_threads, max_reported, [&](tetra_k t, block_result& res) {
+        tetra const& v = tetras[t];
+        for (int i = 0; i < 4; ++i)
+        {
+            if (v[i] < 0 || size_t(v[i]) >= points.size() || find(v.begin(), v.begin() + i, v[i]) != v.begin() + i)
+            {
+                report_bad(res, BAD_VERTICES, t);
+                return;
+            }
+        }
+        valid[t] = 1;
+        for (auto&& k : v)
+            used[k].store(1, memory_order_relaxed);
+        if (orient3d(pos(v[0]), pos(v[1]), pos(v[2]), pos(v[3])) <= 0)
+            report_bad(res, INVERTED, t);
+        REAL vol = orient3dfast(pos(v[0]), pos(v[1]), pos(v[2]), pos(v[3])) / 6;
+        res.volume += vol;
+        res.abs_volume += fabs(vol);
+    });
+    report.num_bad_vertices = res.num_bad[BAD_VERTICES];
+    report.bad_vertices = res.bad[BAD_VERTICES];
+    report.num_inverted = res.num_bad[INVERTED];
+    report.inverted = res.bad[INVERTED];
+    report.volume = res.volume;
+    REAL abs_volume = res.abs_volume;
+    for (size_t k = 0; k < points.size(); ++k)
+        report.num_vertices += used[k].load(memory_order_relaxed);
+    if (neighbors.size() != num)
+        return report.ok();
+
+    // adjacency, local Delaunay test across the interior faces and hull volume,
+    // relative to the first point of the first valid tetra
+    auto first_valid = find(valid.begin(), valid.end(), 1);
+    REAL* ref = first_valid != valid.end() ? pos(tetras[first_valid - valid.begin()][0]) : nullptr;
+    res = for_blocks(num, num_threads, max_reported, [&](tetra_k t, block_result& res) {
+        tetra const& v = tetras[t];
+        bool bad_adjacency = false;
+        bool non_delaunay = false;
+        for (int i = 0; i < 4; ++i)
+        {
+            tetra_k n = neighbors[t][i];
+            if (n == -1)
+            {
+                ++res.num_hull_faces;
+                if (!valid[t])
+                    continue;
+                REAL vol = orient3dfast(pos(v[FACET[i][0]]), pos(v[FACET[i][1]]), pos(v[FACET[i][2]]), ref) / 6;
+                res.hull_volume += vol;
+                res.abs_hull_volume += fabs(vol);
+                continue;
+            }
+            if (n < 0 || size_t(n) >= num || n == t)
+            {
+                bad_adjacency = true;
+                continue;
+            }
+            auto&& back = neighbors[n];
+            int j = find(back.begin(), back.end(), t) - back.begin();
+            if (j == 4)
+            {
+                bad_adjacency = true;
+                continue;
+            }
+            // the face opposite v[i] is the face of n opposite its vertex j
+            tetra const& w = tetras[n];
+            for (int k = 0; k < 3; ++k)
+            {
+                point_k f = v[FACET[i][k]];
+                int l = find(w.begin(), w.end(), f) - w.begin();
+                if (l == 4 || l == j)
+                    bad_adjacency = true;
+            }
+            if (bad_adjacency || !valid[t] || !valid[n])
+                continue;
+            REAL conflict = weights.empty()
+                ? insphere(pos(v[0]), pos(v[1]), pos(v[2]), pos(v[3]), pos(w[j]))
+                : powertest(pos(v[0]), pos(v[1]), pos(v[2]), pos(v[3]), pos(w[j]),
+                    weights[v[0]], weights[v[1]], weights[v[2]], weights[v[3]], weights[w[j]]);
+            if (conflict > 0)
+                non_delaunay = true;
+        }
+        if (bad_adjacency)
+            report_bad(res, BAD_ADJACENCY, t);
+        if (non_delaunay)
+            report_bad(res, NON_DELAUNAY, t);
+    });
+    report.num_hull_faces = res.num_hull_faces;
+    report.num_bad_adjacency = res.num_bad[BAD_ADJACENCY];
+    report.bad_adjacency = res.bad[BAD_ADJACENCY];
+    report.num_non_delaunay = res.num_bad[NON_DELAUNAY];
+    report.non_delaunay = res.bad[NON_DELAUNAY];
+    report.hull_volume = res.hull_volume;
+    report.volume_ok = fabs(report.volume - report.hull_volume) <= 1e-9 * (abs_volume + res.abs_hull_volume);
+    report.num_faces = (4 * num + report.num_hull_faces) / 2;
+    if (report.num_bad_adjacency != 0 || report.num_bad_vertices != 0)
+        return report.ok();
+
+    // Count every edge once, in the tetra of smallest key around it. The tetras
+    // around edge ab are visited by crossing the faces containing ab in turn,
+    // both ways if the edge is on the hull.
+    res = for_blocks(num, num_threads, max_reported, [&](tetra_k t, block_result& res) {
+        tetra const& v = tetras[t];
+        for (auto&& e : EDGES)
+        {
+            point_k a = v[e[0]];
+            point_k b = v[e[1]];
+            point_k others[2];
+            int num_others = 0;
+            for (int k = 0; k < 4; ++k)
+            {
+                if (k != e[0] && k != e[1])
+                    others[num_others++] = v[k];
+            }
+            bool owner = true;
+            bool closed = false;
+            for (int dir = 0; dir < 2 && owner && !closed; ++dir)
+            {
+                tetra_k cur = t;
+                // cross the face of cur opposite x, the other vertex of cur off ab is y
+                point_k x = others[dir];
+                point_k y = others[1 - dir];
+                for (;;)
+                {
+                    auto&& w = tetras[cur];
+                    tetra_k n = neighbors[cur][find(w.begin(), w.end(), x) - w.begin()];
+                    if (n == -1)
+                        break;
+                    if (n == t)
+                    {
+                        closed = true;
+                        break;
+                    }
+                    if (n < t)
+                    {
+                        owner = false;
+                        break;
+                    }
+                    // n is ab, y and a new vertex z, next cross the face of n opposite y
+                    auto&& z = tetras[n];
+                    point_k next = -1;
+                    for (auto&& k : z)
+                    {
+                        if (k != a && k != b && k != y)
+                            next = k;
+                    }
+                    x = y;
+                    y = next;
+                    cur = n;
+                }
+            }
+            if (owner)
+                ++res.num_edges;
+        }
+    });
+    report.num_edges = res.num_edges;
+    report.euler_characteristic = int64_t(report.num_vertices) - int64_t(report.num_edges)
+        + int64_t(report.num_faces) - int64_t(num);
+    return report.ok();
+}
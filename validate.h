@@ -0,0 +1,56 @@
+#ifndef VALIDATE_H
+
+#define VALIDATE_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "types.h"
+
+// Checks of a Delaunay tetrahedralization, linear in the number of tetras:
+//   - every vertex key is a point, and the 4 vertices of a tetra differ
+//   - every tetra is positively oriented
+//   - neighbors link back and share the face, each hull face has no neighbor
+//   - the opposite point of each neighbor is not strictly inside the circumsphere
+//     (locally Delaunay across every interior face, which makes the whole mesh Delaunay),
+//     or with weights not in conflict with the orthogonal sphere by the power test
+//     (locally regular)
+//   - the volumes of the tetras add up to the volume enclosed by the hull faces
+//   - V - E + F - T is 1, as for a ball
+struct validation_report {
+	size_t num_tetras;
+	// vertices used by some tetra, edges, faces and the faces on the hull
+	size_t num_vertices;
+	size_t num_edges;
+	size_t num_faces;
+	size_t num_hull_faces;
+	// Offending tetras, the smallest keys first, at most max_reported of each,
+	// and the number of offending tetras.
+	std::vector<tetra_k> bad_vertices;
+	std::vector<tetra_k> inverted;
+	std::vector<tetra_k> bad_adjacency;
+	std::vector<tetra_k> non_delaunay;
+	size_t num_bad_vertices;
+	size_t num_inverted;
+	size_t num_bad_adjacency;
+	size_t num_non_delaunay;
+	// sum of the tetra volumes, and the volume enclosed by the hull faces
+	REAL volume;
+	REAL hull_volume;
+	bool volume_ok;
+	int64_t euler_characteristic;
+
+	validation_report();
+	bool ok() const;
+	void write_text(std::ostream& os) const;
+};
+
+// Validate the tetras of points with their neighbors, neighbor i across the face
+// opposite vertex i and -1 on the hull, as given by triangulator::compact(). The
+// tetras of a regular triangulation are tested with the weights of the points.
+// Runs on num_threads threads, 0 for all cores. Return report.ok().
+bool validate_mesh(span<xyz const> points, span<tetra const> tetras, span<tetra_neighbors const> neighbors,
+	validation_report& report, int num_threads = 0, size_t max_reported = 16,
+	span<REAL const> weights = span<REAL const>());
+
+#endif
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include "voronoi.h"
+using namespace std;
+
+
+// Tetras, edges or cells per block, the unit of parallel work.
+static size_t const VORONOI_GRAIN = 1 << 12;
+
+// The 6 edges ab of a tetra as the indices of a, b and the other two vertices x, y,
+// an even permutation, so that a, b, x, y is positively oriented like the tetra.
+static int const EDGES[6][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 2, 0, 3}, {1, 3, 2, 0}, {2, 3, 0, 1}};
+
+// A Delaunay edge ab found in tetra t as EDGES[e], with the faces it gives in the
+// cells of a and b.
+struct edge_record
+{
+    point_k a;
+    point_k b;
+    tetra_k t;
+    int e;
+    // tetras around the edge, and whether they close around it
+    size_t num_tetras;
+    bool closed;
+    size_t faces[2];
+};
+
+// Circumcenter of the tetra v, its centroid if it is flat.
+static xyz circumcenter(span<xyz const> points, tetra const& v)
+{
+    xyz const& a = points[v[0]];
+    xyz e[3];
+    REAL len2[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        for (int k = 0; k < 3; ++k)
+            e[j][k] = points[v[j + 1]][k] - a[k];
+        len2[j] = e[j][0] * e[j][0] + e[j][1] * e[j][1] + e[j][2] * e[j][2];
+    }
+    xyz cross[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        xyz const& p = e[(j + 1) % 3];
+        xyz const& q = e[(j + 2) % 3];
+        cross[j] = {p[1] * q[2] - p[2] * q[1], p[2] * q[0] - p[0] * q[2], p[0] * q[1] - p[1] * q[0]};
+    }
+    REAL det = e[0][0] * cross[0][0] + e[0][1] * cross[0][1] + e[0][2] * cross[0][2];
+    xyz ret;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (det != 0)
+            ret[k] = a[k] + (len2[0] * cross[0][k] + len2[1] * cross[1][k] + len2[2] * cross[2][k]) / (2 * det);
+        else
+            ret[k] = a[k] + 0.25 * (e[0][k] + e[1][k] + e[2][k]);
+    }
+    return ret;
+}
+
+// Rotate around edge ab from tetra t, whose other vertices are x and y, crossing
+// first the face of t opposite x: counterclockwise seen from a if a, b, x, y is
+// positively oriented (orient3d() > 0). Call visit(n) on each tetra entered until
+// the walk is back at t or leaves the mesh, visit returns false to stop it.
+// Return 1 back at t, 0 out of the mesh and -1 if stopped.
+template <typename Visit>
+static int rotate(span<tetra const> tetras, span<tetra_neighbors const> neighbors, tetra_k t,
+    point_k a, point_k b, point_k x, point_k y, Visit visit)
+{
+    tetra_k cur = t;
+    for (;;)
+    {
+        auto&& w = tetras[cur];
+        tetra_k n = neighbors[cur][find(w.begin(), w.end(), x) - w.begin()];
+        if (n == -1)
+            return 0;
+        if (n == t)
+            return 1;
+        if (!visit(n))
+            return -1;
+        // n is ab, y and a new vertex z, next cross the face of n opposite y
+        point_k next = -1;
+        for (auto&& k : tetras[n])
+        {
+            if (k != a && k != b && k != y)
+                next = k;
+        }
+        x = y;
+        y = next;
+        cur = n;
+    }
+}
+
+bool compute_voronoi(span<xyz const> points, span<tetra const> tetras, span<tetra_neighbors const> neighbors,
+    voronoi_diagram& diagram, int num_threads)
+{
+    diagram = voronoi_diagram();
+    size_t num = tetras.size();
+    if (neighbors.size() != num)
+        return false;
+    size_t num_points = points.size();
+    REAL const inf = numeric_limits<REAL>::infinity();
+    tbb::task_arena arena(num_threads > 0 ? num_threads : int(tbb::task_arena::automatic));
+
+    // Circumcenters, and the edges of each block of tetras. An edge belongs to the
+    // tetra of smallest key around it.
+    diagram.vertices.resize(num);
+    size_t num_blocks = (num + VORONOI_GRAIN - 1) / VORONOI_GRAIN;
+    vector<vector<edge_record> > block_edges(num_blocks);
+    arena.execute([&] {
+        tbb::parallel_for(size_t(0), num_blocks, [&](size_t blk) {
+            for (tetra_k t = blk * VORONOI_GRAIN; t < tetra_k(min(num, (blk + 1) * VORONOI_GRAIN)); ++t)
+            {
+                tetra const& v = tetras[t];
+                diagram.vertices[t] = circumcenter(points, v);
+                for (int e = 0; e < 6; ++e)
+                {
+                    point_k a = v[EDGES[e][0]];
+                    point_k b = v[EDGES[e][1]];
+                    point_k x = v[EDGES[e][2]];
+                    point_k y = v[EDGES[e][3]];
+                    size_t count = 1;
+                    auto visit = [&](tetra_k n) {
+                        ++count;
+                        return n > t;
+                    };
+                    int res = rotate(tetras, neighbors, t, a, b, x, y, visit);
+                    if (res == -1 || (res == 0 && rotate(tetras, neighbors, t, a, b, y, x, visit) == -1))
+                        continue;
+                    edge_record edge = {a, b, t, e, count, res == 1, {0, 0}};
+                    block_edges[blk].push_back(edge);
+                }
+            }
+        });
+    });
+    vector<edge_record> edges;
+    size_t num_edges = 0;
+    for (auto&& b : block_edges)
+        num_edges += b.size();
+    edges.reserve(num_edges);
+    for (auto&& b : block_edges)
+    {
+        edges.insert(edges.end(), b.begin(), b.end());
+        vector<edge_record>().swap(b);
+    }
+
+    // Each edge gives a face to the cells of a and b. Count them, then place them
+    // and sort the faces of each cell by the point across.
+    unique_ptr<atomic<size_t>[]> cursor(new atomic<size_t>[num_points]());
+    diagram.cell_offsets.resize(num_points + 1, 0);
+    size_t num_faces = 2 * num_edges;
+    diagram.face_points.resize(num_faces);
+    vector<size_t> face_edges(num_faces);
+    diagram.face_offsets.resize(num_faces + 1, 0);
+    diagram.face_areas.resize(num_faces);
+    diagram.cell_volumes.resize(num_points);
+    arena.execute([&] {
+        tbb::parallel_for(size_t(0), num_edges, [&](size_t i) {
+            cursor[edges[i].a].fetch_add(1, memory_order_relaxed);
+            cursor[edges[i].b].fetch_add(1, memory_order_relaxed);
+        });
+    });
+    for (size_t k = 0; k < num_points; ++k)
+    {
+        diagram.cell_offsets[k + 1] = diagram.cell_offsets[k] + cursor[k].load(memory_order_relaxed);
+        cursor[k].store(diagram.cell_offsets[k], memory_order_relaxed);
+    }
+    arena.execute([&] {
+        tbb::parallel_for(size_t(0), num_edges, [&](size_t i) {
+            size_t fa = cursor[edges[i].a].fetch_add(1, memory_order_relaxed);
+            size_t fb = cursor[edges[i].b].fetch_add(1, memory_order_relaxed);
+            diagram.face_points[fa] = edges[i].b;
+            diagram.face_points[fb] = edges[i].a;
+            face_edges[fa] = i;
+            face_edges[fb] = i;
+        });
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_points, VORONOI_GRAIN), [&](tbb::blocked_range<size_t> const& r) {
+            vector<pair<point_k, size_t> > faces;
+            for (size_t k = r.begin(); k != r.end(); ++k)
+            {
+                size_t begin = diagram.cell_offsets[k];
+                size_t end = diagram.cell_offsets[k + 1];
+                faces.clear();
+                for (size_t f = begin; f < end; ++f)
+                    faces.push_back(make_pair(diagram.face_points[f], face_edges[f]));
+                sort(faces.begin(), faces.end());
+                for (size_t f = begin; f < end; ++f)
+                {
+                    diagram.face_points[f] = faces[f - begin].first;
+                    face_edges[f] = faces[f - begin].second;
+                    edge_record& edge = edges[face_edges[f]];
+                    edge.faces[edge.a == point_k(k) ? 0 : 1] = f;
+                }
+            }
+        });
+    });
+    cursor.reset();
+    for (size_t f = 0; f < num_faces; ++f)
+        diagram.face_offsets[f + 1] = diagram.face_offsets[f] + edges[face_edges[f]].num_tetras;
+    vector<size_t>().swap(face_edges);
+
+    // The circumcenters around each edge, counterclockwise seen from a, which is
+    // outside the cell of b, and the area of the face.
+    diagram.face_vertices.resize(diagram.face_offsets[num_faces]);
+    arena.execute([&] {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_edges, VORONOI_GRAIN), [&](tbb::blocked_range<size_t> const& r) {
+            vector<tetra_k> ring;
+            vector<tetra_k> back;
+            for (size_t i = r.begin(); i != r.end(); ++i)
+            {
+                edge_record const& edge = edges[i];
+                tetra const& v = tetras[edge.t];
+                point_k x = v[EDGES[edge.e][2]];
+                point_k y = v[EDGES[edge.e][3]];
+                ring.assign(1, edge.t);
+                back.clear();
+                rotate(tetras, neighbors, edge.t, edge.a, edge.b, x, y, [&](tetra_k n) {
+                    ring.push_back(n);
+                    return true;
+                });
+                if (!edge.closed)
+                {
+                    rotate(tetras, neighbors, edge.t, edge.a, edge.b, y, x, [&](tetra_k n) {
+                        back.push_back(n);
+                        return true;
+                    });
+                    ring.insert(ring.begin(), back.rbegin(), back.rend());
+                }
+                copy(ring.rbegin(), ring.rend(), diagram.face_vertices.begin() + diagram.face_offsets[edge.faces[0]]);
+                copy(ring.begin(), ring.end(), diagram.face_vertices.begin() + diagram.face_offsets[edge.faces[1]]);
+                REAL area = inf;
+                if (edge.closed)
+                {
+                    xyz const& pa = points[edge.a];
+                    xyz const& pb = points[edge.b];
+                    xyz axis = {pa[0] - pb[0], pa[1] - pb[1], pa[2] - pb[2]};
+                    REAL len = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+                    xyz const& c0 = diagram.vertices[ring[0]];
+                    area = 0;
+                    for (size_t j = 1; j + 1 < ring.size(); ++j)
+                    {
+                        xyz const& c1 = diagram.vertices[ring[j]];
+                        xyz const& c2 = diagram.vertices[ring[j + 1]];
+                        xyz p = {c1[0] - c0[0], c1[1] - c0[1], c1[2] - c0[2]};
+                        xyz q = {c2[0] - c0[0], c2[1] - c0[1], c2[2] - c0[2]};
+                        area += (p[1] * q[2] - p[2] * q[1]) * axis[0] + (p[2] * q[0] - p[0] * q[2]) * axis[1]
+                            + (p[0] * q[1] - p[1] * q[0]) * axis[2];
+                    }
+                    area /= 2 * len;
+                }
+                diagram.face_areas[edge.faces[0]] = area;
+                diagram.face_areas[edge.faces[1]] = area;
+            }
+        });
+
+        // A cell is the union of the pyramids from its point to its faces, each of
+        // height half the distance to the point across.
+        tbb::parallel_for(size_t(0), num_points, [&](size_t k) {
+            REAL volume = 0;
+            for (size_t f = diagram.cell_offsets[k]; f < diagram.cell_offsets[k + 1]; ++f)
+            {
+                xyz const& p = points[k];
+                xyz const& q = points[diagram.face_points[f]];
+                REAL dist = sqrt((q[0] - p[0]) * (q[0] - p[0]) + (q[1] - p[1]) * (q[1] - p[1]) + (q[2] - p[2]) * (q[2] - p[2]));
+                volume += diagram.face_areas[f] * dist / 6;
+            }
+            diagram.cell_volumes[k] = volume;
+        });
+    });
+    return true;
+}
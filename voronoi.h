@@ -0,0 +1,40 @@
+#ifndef VORONOI_H
+
+#define VORONOI_H
+
+#include <vector>
+#include "types.h"
+
+// The Voronoi diagram dual to a Delaunay tetrahedralization, in compressed rows.
+// Each tetra gives a Voronoi vertex, its circumcenter, and each Delaunay edge ab
+// the face between the cells of a and b, stored once in each cell.
+struct voronoi_diagram {
+	// the circumcenter of each tetra, by tetra key
+	std::vector<xyz> vertices;
+	// faces of the cell of point k: cell_offsets[k] to cell_offsets[k + 1],
+	// sorted by the point across them
+	std::vector<size_t> cell_offsets;
+	// the point on the other side of each face
+	std::vector<point_k> face_points;
+	// Voronoi vertices of face f: face_vertices[face_offsets[f]] to
+	// face_vertices[face_offsets[f + 1]], counterclockwise seen from outside the cell.
+	// A face of a hull edge is unbounded, and lists its bounded part as an open chain.
+	std::vector<size_t> face_offsets;
+	std::vector<tetra_k> face_vertices;
+	// area of each face, infinite if it is unbounded
+	std::vector<REAL> face_areas;
+	// volume of each cell, infinite for the points on the hull, 0 for points of no tetra
+	std::vector<REAL> cell_volumes;
+
+	size_t num_faces() const {
+		return face_points.size();
+	}
+};
+
+// Build the Voronoi diagram of points from their tetras and neighbors, as given by
+// triangulator::compact(). Runs on num_threads threads, 0 for all cores, in time
+// linear in the number of tetras. Return false if neighbors do not match tetras.
+bool compute_voronoi(span<xyz const> points, span<tetra const> tetras, span<tetra_neighbors const> neighbors,
+	voronoi_diagram& diagram, int num_threads = 0);
+
+#endif